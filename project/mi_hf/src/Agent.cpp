@@ -4,26 +4,69 @@
 
 #include <algorithm>
 #include <cassert>
-#include <numeric>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+
+namespace {
+
+/// First bytes of a checkpoint file, see Agent::SaveCheckpoint.
+/// The file is in the native byte order, padded after the header so the
+/// tables start at a page boundary, and the random engine's state follows the
+/// tables as text.
+struct CheckpointHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize; ///< sizeof(CheckpointHeader), to catch ABI differences.
+	int32_t width;
+	int32_t height;
+	uint32_t layout; ///< TableLayout::eType.
+	uint32_t storage; ///< See eCheckpointStorage.
+	uint64_t tableSize; ///< Number of states in the tables, including padding.
+	uint64_t tableOffset;
+	uint64_t tableBytes;
+	uint64_t rngOffset;
+	uint64_t rngBytes;
+};
+
+enum eCheckpointStorage : uint32_t {
+	SEPARATE = 0,
+	INTERLEAVED = 1,
+	QUANTIZED = 2,
+};
+
+constexpr char checkpointMagic[8] = { 'M', 'I', 'H', 'F', 'Q', 'T', 'B', 'L' };
+constexpr uint32_t checkpointVersion = 2;
+constexpr uint64_t checkpointAlignment = 4096;
+
+}
 
 
 Agent::Agent() :
+	rne(Seed()),
 	rng_roll(0.0f, 1.0f),
 	rng_action(0, 3),
-	rne(Seed())
+	random(RandomSource::MT19937, 0)
 {
 	currentGame = nullptr;
+	random.SetSeed(rne());
 }
 
 
 eAction Agent::SelectNextStep(int x, int y) {
-	real roll = rng_roll(rne);
+	const bool buffered = random.GetEngine() != RandomSource::MT19937;
+	real roll = buffered ? random.Uniform() : rng_roll(rne);
 	eAction action;
 	// normal behaviour
 	float utility = -std::numeric_limits<real>::infinity();
 	if (roll > explorerness) {
 		for (int i = 0; i < 4; i++) {
-			float value = Q(x, y, (eAction)i);
+			float value = GetQ(x, y, (eAction)i);
 			if (utility < value) {
 				utility = value;
 				action = (eAction)i;
@@ -31,14 +74,16 @@ eAction Agent::SelectNextStep(int x, int y) {
 		}
 
 
+#ifdef _MSC_VER
 		if (utility == -std::numeric_limits<real>::infinity()) {
 			__debugbreak();
 		}
+#endif
 		assert(utility != -std::numeric_limits<real>::infinity());
 	}
 	// random exploration
 	else {
-		action = (eAction)rng_action(rne);
+		action = buffered ? (eAction)(int)(random.Uniform() * 4) : (eAction)rng_action(rne);
 	}
 	return action;
 }
@@ -53,55 +98,222 @@ void Agent::Step() {
 	int x = currentGame->GetCurrentX();
 	int y = currentGame->GetCurrentY();
 	int newx, newy;
-	real Qold;
-	real Qmax;
 	eAction action;
 	real reward;
 
 	// select action by strategy
 	action = SelectNextStep(x, y);
 
-	Qold = GetQ(x, y, action);
+	// the next state is either the intended one, a slip to the side, or this
+	if (prefetchNext) {
+		static constexpr int deltaX[4] = { 0, 0, -1, 1 };
+		static constexpr int deltaY[4] = { 1, -1, 0, 0 };
+		static constexpr eAction sides[4][2] = { { LEFT, RIGHT }, { LEFT, RIGHT }, { UP, DOWN }, { UP, DOWN } };
+		const eAction moves[3] = { action, sides[action][0], sides[action][1] };
+		for (eAction move : moves) {
+			int nx = std::min((int)width - 1, std::max(0, x + deltaX[move]));
+			int ny = std::min((int)height - 1, std::max(0, y + deltaY[move]));
+			Prefetch(&QAt(layout.Index(nx, ny)));
+		}
+	}
 
 	// perform action
 	bool isOver = currentGame->PerformAction(action);
-	N(x, y, action)++;
 
 	// perceive the environment
 	reward = currentGame->GetCurrentReward();
 	newx = currentGame->GetCurrentX();
 	newy = currentGame->GetCurrentY();
 
+	Learn(x, y, action, newx, newy, (float)reward, isOver);
+
+	// log reward just for fun
+	totalReward += reward;
+}
+
+void Agent::Learn(int x, int y, eAction action, int newx, int newy, float reward, bool isOver) {
+	real Qold = GetQ(x, y, action);
+	IncrementN(x, y, action);
+
 	// update Q accordingly
-	Qmax = GetQMax(newx, newy);
+	real Qmax = GetQMax(newx, newy);
 
 	if (!isOver) {
-		Q(x, y, action) = Qold + alpha*(reward + gamma*Qmax - Qold);
+		SetQ(x, y, action, Qold + alpha*(reward + gamma*Qmax - Qold));
 	}
 	else {
 		for (int i = 0; i < 4; i++) {
-			Q(newx, newy, (eAction)i) = reward;
+			SetQ(newx, newy, (eAction)i, reward);
 		}
-		Q(x, y, action) = Qold + alpha*(reward - Qold);
+		SetQ(x, y, action, Qold + alpha*(reward - Qold));
 	}
 
-	// log reward just for fun
-	totalReward += reward;
+	if (!model.empty()) {
+		Plan(x, y, action, newx, newy, reward, isOver);
+	}
 }
 
-void Agent::Reset() {
-	for (auto& q : Q_) {
-		for (auto& v : q) {
-			v = 0;
+void Agent::Plan(int x, int y, eAction action, int newx, int newy, float reward, bool isOver) {
+	// record the outcome
+	int next = newy*width + newx;
+	ModelEntry& entry = model[(y*width + x) * 4 + action];
+	for (int i = 0; i < 3; ++i) {
+		if (entry.count[i] == 0 || entry.next[i] == next) {
+			entry.next[i] = next;
+			entry.count[i]++;
+			break;
 		}
 	}
-	for (auto& n : N_) {
-		for (auto& v : n) {
-			v = 0;
+	modelReward[next] = reward;
+	modelTerminal[next] = isOver;
+
+	QueueForPlanning(x, y, action);
+
+	// prioritized sweeping
+	for (int i = 0; i < planningSteps && !planningQueue.empty(); ) {
+		PlanningItem item = planningQueue.top();
+		planningQueue.pop();
+		int cell = item.y*width + item.x;
+		float& priority = priorities[cell * 4 + item.action];
+		if (item.priority != priority) {
+			continue; // outdated
 		}
+		priority = 0;
+		++i;
+
+		SetQ(item.x, item.y, item.action, ModelTarget(item.x, item.y, item.action));
+
+		// the predecessors can only be the field itself and its neighbours
+		const int candidates[5][2] = {
+			{ item.x, item.y },
+			{ item.x - 1, item.y },
+			{ item.x + 1, item.y },
+			{ item.x, item.y - 1 },
+			{ item.x, item.y + 1 },
+		};
+		for (auto& candidate : candidates) {
+			int px = candidate[0];
+			int py = candidate[1];
+			if (px < 0 || (size_t)px >= width || py < 0 || (size_t)py >= height) {
+				continue;
+			}
+			for (int a = 0; a < 4; ++a) {
+				const ModelEntry& predecessor = model[(py*width + px) * 4 + a];
+				for (int k = 0; k < 3; ++k) {
+					if (predecessor.count[k] > 0 && predecessor.next[k] == cell) {
+						QueueForPlanning(px, py, (eAction)a);
+						break;
+					}
+				}
+			}
+		}
+	}
+}
+
+float Agent::ModelTarget(int x, int y, eAction action) const {
+	const ModelEntry& entry = model[(y*width + x) * 4 + action];
+	real sum = 0;
+	int total = 0;
+	for (int i = 0; i < 3 && entry.count[i] > 0; ++i) {
+		int next = entry.next[i];
+		real value = modelReward[next];
+		if (!modelTerminal[next]) {
+			value += gamma * GetQMax(next % width, next / width);
+		}
+		sum += entry.count[i] * value;
+		total += entry.count[i];
+	}
+	return total > 0 ? (float)(sum / total) : GetQ(x, y, action);
+}
+
+void Agent::QueueForPlanning(int x, int y, eAction action) {
+	float error = std::abs(ModelTarget(x, y, action) - GetQ(x, y, action));
+	float& priority = priorities[(y*width + x) * 4 + action];
+	if (error > planningThreshold && error > priority) {
+		priority = error;
+		planningQueue.push({ error, x, y, action });
 	}
 }
 
+void Agent::SetPlanning(int numSteps, float threshold) {
+	planningSteps = numSteps;
+	planningThreshold = threshold;
+}
+
+void Agent::SetLayout(TableLayout::eType layout) {
+	layoutType = layout;
+}
+
+void Agent::SetInterleaved(bool interleaved) {
+	this->interleaved = interleaved;
+}
+
+void Agent::SetQuantized(bool quantized) {
+	this->quantized = quantized;
+}
+
+void Agent::SetSparse(bool sparse) {
+	this->sparse = sparse;
+}
+
+void Agent::CopySettings(const Agent& other) {
+	SetPlanning(other.planningSteps, other.planningThreshold);
+	layoutType = other.layoutType;
+	interleaved = other.interleaved;
+	quantized = other.quantized;
+	sparse = other.sparse;
+}
+
+void Agent::Reset() {
+	ResetModel();
+	if (!tables) {
+		return;
+	}
+	if (sparse_) {
+		sparse_->Clear();
+		return;
+	}
+	for (size_t i = 0; i < tables->size; ++i) {
+		if (QN16_) {
+			for (auto& v : QN16_[i].q) {
+				v.store(0, std::memory_order_relaxed);
+			}
+			for (auto& v : QN16_[i].n) {
+				v.store(0, std::memory_order_relaxed);
+			}
+			continue;
+		}
+		for (auto& v : QAt(i)) {
+			v.store(0, std::memory_order_relaxed);
+		}
+		for (auto& v : NAt(i)) {
+			v.store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+
+void Agent::ResetModel() {
+	if (model.empty()) {
+		return;
+	}
+	std::fill(model.begin(), model.end(), ModelEntry{ { 0, 0, 0 }, { 0, 0, 0 } });
+	std::fill(modelReward.begin(), modelReward.end(), 0.0f);
+	std::fill(modelTerminal.begin(), modelTerminal.end(), (uint8_t)0);
+	std::fill(priorities.begin(), priorities.end(), 0.0f);
+	planningQueue = {};
+}
+
+void Agent::SetSeed(size_t seed) {
+	rne.seed((std::mt19937::result_type)seed);
+	random.SetSeed(seed);
+}
+
+
+void Agent::SetRandomEngine(RandomSource::eEngine engine) {
+	random.SetEngine(engine);
+}
+
 
 void Agent::StartEpisode() {
 	totalReward = 0;
@@ -113,38 +325,387 @@ float Agent::EndEpisode() {
 }
 
 
+Agent::Tables::Tables(size_t size, bool interleaved, bool quantized, bool sparse) :
+	Q(interleaved || quantized || sparse ? nullptr : new QItem[size]),
+	N(interleaved || quantized || sparse ? nullptr : new NItem[size]),
+	records(interleaved && !quantized && !sparse ? new Record[size] : nullptr),
+	quantizedRecords(quantized && !sparse ? new QuantizedRecord[size] : nullptr),
+	sparse(sparse ? new SparseTable() : nullptr),
+	interleaved(interleaved && !quantized && !sparse),
+	size(size)
+{
+	if (records) {
+		q = reinterpret_cast<char*>(&records[0].q);
+		n = reinterpret_cast<char*>(&records[0].n);
+		strideShift = 5;
+	}
+	else if (Q) {
+		q = reinterpret_cast<char*>(Q.get());
+		n = reinterpret_cast<char*>(N.get());
+	}
+	this->quantized = quantizedRecords.get();
+}
+
+
+Agent::Tables::Tables(std::unique_ptr<MappedFile> file, size_t offset, size_t size, bool interleaved, bool quantized) :
+	file(std::move(file)),
+	interleaved(interleaved && !quantized),
+	size(size)
+{
+	char* data = this->file->GetData() + offset;
+	if (quantized) {
+		this->quantized = reinterpret_cast<QuantizedRecord*>(data);
+	}
+	else if (interleaved) {
+		q = data + offsetof(Record, q);
+		n = data + offsetof(Record, n);
+		strideShift = 5;
+	}
+	else {
+		q = data;
+		n = data + size * sizeof(QItem);
+	}
+}
+
+
+size_t Agent::Tables::GetBytes() const {
+	if (sparse) {
+		return 0;
+	}
+	return size * (quantized ? sizeof(QuantizedRecord) : sizeof(QItem) + sizeof(NItem));
+}
+
+
+void Agent::AttachTables() {
+	Q_ = tables->q;
+	N_ = tables->n;
+	strideShift = tables->strideShift;
+	QN16_ = tables->quantized;
+	sparse_ = tables->sparse.get();
+	prefetchNext = tables->interleaved;
+}
+
+
 void Agent::SetGame(Game* game) {
 	currentGame = game;
-	if (game->GetMap()) {
+	sharedTables = sharedTables && tables.use_count() > 1;
+	if (sharedTables) {
+		assert(!game->GetMap() || ((size_t)game->GetMap()->GetWidth() == width && (size_t)game->GetMap()->GetHeight() == height));
+	}
+	else if (game->GetMap()) {
 		width = game->GetMap()->GetWidth();
 		height = game->GetMap()->GetHeight();
-		Q_.resize(width*height);
-		N_.resize(width*height);
+		layout = TableLayout(sparse ? TableLayout::ROW_MAJOR : layoutType, (int)width, (int)height);
+		size_t size = sparse ? 0 : layout.GetCapacity();
+		bool sameStorage = tables
+			&& tables->size == size
+			&& (tables->sparse != nullptr) == sparse
+			&& (sparse || (tables->quantized != nullptr) == quantized)
+			&& (sparse || quantized || tables->interleaved == interleaved);
+		if (!sameStorage) {
+			tables = std::make_shared<Tables>(size, interleaved, quantized, sparse);
+			AttachTables();
+		}
+	}
+
+	size_t numCells = planningSteps > 0 ? width*height : 0;
+	model.assign(numCells * 4, ModelEntry{ { 0, 0, 0 }, { 0, 0, 0 } });
+	modelReward.assign(numCells, 0.0f);
+	modelTerminal.assign(numCells, 0);
+	priorities.assign(numCells * 4, 0.0f);
+	planningQueue = {};
+
+	if (!sharedTables) {
+		Reset();
+	}
+}
+
+void Agent::ShareTables(Agent& other) {
+	assert(other.tables);
+	assert(!other.tables->sparse);
+	tables = other.tables;
+	AttachTables();
+	layout = other.layout;
+	width = other.width;
+	height = other.height;
+	sharedTables = true;
+	other.sharedTables = true;
+}
+
+void Agent::SetQ(int x, int y, eAction action, float value) {
+	assert(0 <= x && x < width && 0 <= y && y < height);
+	if (sparse_) {
+		sparse_->Insert((uint32_t)(y*width + x)).q[action] = value;
+		return;
+	}
+	size_t index = layout.Index(x, y);
+	if (QN16_) {
+		float scaled = std::min(32767.0f, std::max(-32768.0f, value * quantizedScale));
+		QN16_[index].q[action].store((int16_t)std::lrint(scaled), std::memory_order_relaxed);
+		return;
 	}
-	Reset();
+	QAt(index)[action].store(value, std::memory_order_relaxed);
 }
 
-float& Agent::Q(int x, int y, eAction action) {
+void Agent::IncrementN(int x, int y, eAction action) {
 	assert(0 <= x && x < width && 0 <= y && y < height);
-	return Q_[y*width + x][action];
+	if (sparse_) {
+		sparse_->Insert((uint32_t)(y*width + x)).n[action]++;
+		return;
+	}
+	size_t index = layout.Index(x, y);
+	if (QN16_) {
+		auto& n = QN16_[index].n[action];
+		uint16_t count = n.load(std::memory_order_relaxed);
+		if (sharedTables) {
+			while (count < UINT16_MAX && !n.compare_exchange_weak(count, count + 1, std::memory_order_relaxed));
+		}
+		else if (count < UINT16_MAX) {
+			n.store(count + 1, std::memory_order_relaxed);
+		}
+		return;
+	}
+	auto& n = NAt(index)[action];
+	if (sharedTables) {
+		n.fetch_add(1, std::memory_order_relaxed);
+	}
+	else {
+		n.store(n.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
 }
 
-int& Agent::N(int x, int y, eAction action) {
+void Agent::SetN(int x, int y, eAction action, int value) {
 	assert(0 <= x && x < width && 0 <= y && y < height);
-	return N_[y*width + x][action];
+	if (sparse_) {
+		sparse_->Insert((uint32_t)(y*width + x)).n[action] = value;
+		return;
+	}
+	size_t index = layout.Index(x, y);
+	if (QN16_) {
+		QN16_[index].n[action].store((uint16_t)std::min(value, (int)UINT16_MAX), std::memory_order_relaxed);
+		return;
+	}
+	NAt(index)[action].store(value, std::memory_order_relaxed);
 }
 
 float Agent::GetQ(int x, int y, eAction action) const {
 	assert(0 <= x && x < width && 0 <= y && y < height);
-	return Q_[y*width + x][action];
+	if (sparse_) {
+		auto entry = sparse_->Find((uint32_t)(y*width + x));
+		return entry ? entry->q[action] : sparse_->GetDefaultQ();
+	}
+	size_t index = layout.Index(x, y);
+	if (QN16_) {
+		return QN16_[index].q[action].load(std::memory_order_relaxed) * (1.0f / quantizedScale);
+	}
+	return QAt(index)[action].load(std::memory_order_relaxed);
 }
 
 float Agent::GetQMax(int x, int y) const {
 	assert(0 <= x && x < width && 0 <= y && y < height);
-	return *std::max_element(Q_[y*width + x].begin(), Q_[y*width + x].end());
+	if (sparse_) {
+		auto entry = sparse_->Find((uint32_t)(y*width + x));
+		return entry ? std::max(std::max(entry->q[0], entry->q[1]), std::max(entry->q[2], entry->q[3])) : sparse_->GetDefaultQ();
+	}
+	size_t index = layout.Index(x, y);
+	if (QN16_) {
+		const auto& q = QN16_[index].q;
+		int16_t max = std::max(std::max(q[0].load(std::memory_order_relaxed), q[1].load(std::memory_order_relaxed)),
+							   std::max(q[2].load(std::memory_order_relaxed), q[3].load(std::memory_order_relaxed)));
+		return max * (1.0f / quantizedScale);
+	}
+	const auto& q = QAt(index);
+	return std::max(std::max(q[0].load(std::memory_order_relaxed), q[1].load(std::memory_order_relaxed)),
+					std::max(q[2].load(std::memory_order_relaxed), q[3].load(std::memory_order_relaxed)));
 }
 
 
 int Agent::GetNSum(int x, int y) const {
-	return std::accumulate(N_[y*width + x].begin(), N_[y*width + x].end(), 0);
-}
\ No newline at end of file
+	if (sparse_) {
+		auto entry = sparse_->Find((uint32_t)(y*width + x));
+		return entry ? entry->n[0] + entry->n[1] + entry->n[2] + entry->n[3] : 0;
+	}
+	size_t index = layout.Index(x, y);
+	if (QN16_) {
+		const auto& n = QN16_[index].n;
+		return n[0].load(std::memory_order_relaxed) + n[1].load(std::memory_order_relaxed)
+			+ n[2].load(std::memory_order_relaxed) + n[3].load(std::memory_order_relaxed);
+	}
+	const auto& n = NAt(index);
+	return n[0].load(std::memory_order_relaxed) + n[1].load(std::memory_order_relaxed)
+		+ n[2].load(std::memory_order_relaxed) + n[3].load(std::memory_order_relaxed);
+}
+
+int Agent::GetN(int x, int y, eAction action) const {
+	assert(0 <= x && x < width && 0 <= y && y < height);
+	if (sparse_) {
+		auto entry = sparse_->Find((uint32_t)(y*width + x));
+		return entry ? entry->n[action] : 0;
+	}
+	size_t index = layout.Index(x, y);
+	if (QN16_) {
+		return QN16_[index].n[action].load(std::memory_order_relaxed);
+	}
+	return NAt(index)[action].load(std::memory_order_relaxed);
+}
+
+void Agent::SetEntry(int x, int y, eAction action, float q, int n) {
+	SetQ(x, y, action, q);
+	SetN(x, y, action, n);
+}
+
+size_t Agent::GetTableMemoryUsage() const {
+	if (!tables) {
+		return 0;
+	}
+	if (sparse_) {
+		return sparse_->GetMemoryUsage();
+	}
+	return tables->GetBytes();
+}
+
+bool Agent::GetCheckpointParts(CheckpointParts& parts) const {
+	static_assert(sizeof(std::atomic<float>) == sizeof(float) && sizeof(std::atomic<int>) == sizeof(int),
+				  "checkpoints store the atomic tables as raw memory");
+	if (!tables || sparse_) {
+		return false;
+	}
+	std::ostringstream rngState;
+	rngState << rne << ' ' << random;
+	parts.rngText = rngState.str();
+
+	CheckpointHeader header = {};
+	std::memcpy(header.magic, checkpointMagic, sizeof(header.magic));
+	header.version = checkpointVersion;
+	header.headerSize = sizeof(CheckpointHeader);
+	header.width = (int32_t)width;
+	header.height = (int32_t)height;
+	header.layout = layout.GetType();
+	header.storage = QN16_ ? QUANTIZED : tables->interleaved ? INTERLEAVED : SEPARATE;
+	header.tableSize = tables->size;
+	header.tableOffset = checkpointAlignment;
+	header.tableBytes = tables->GetBytes();
+	header.rngOffset = header.tableOffset + header.tableBytes;
+	header.rngBytes = parts.rngText.size();
+
+	parts.prefix.assign(checkpointAlignment, 0);
+	std::memcpy(parts.prefix.data(), &header, sizeof(header));
+	if (QN16_) {
+		parts.tables[0] = reinterpret_cast<const char*>(QN16_);
+		parts.tableBytes[0] = header.tableBytes;
+		parts.tableBytes[1] = 0;
+	}
+	else if (tables->interleaved) {
+		parts.tables[0] = Q_ - offsetof(Record, q);
+		parts.tableBytes[0] = header.tableBytes;
+		parts.tableBytes[1] = 0;
+	}
+	else {
+		parts.tables[0] = Q_;
+		parts.tableBytes[0] = tables->size * sizeof(QItem);
+		parts.tables[1] = N_;
+		parts.tableBytes[1] = tables->size * sizeof(NItem);
+	}
+	return true;
+}
+
+bool Agent::SaveCheckpoint(const std::string& path) const {
+	CheckpointParts parts;
+	if (!GetCheckpointParts(parts)) {
+		return false;
+	}
+	// same as Snapshot::Write, the tables may be mapped from the target
+	std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		file.write(parts.prefix.data(), parts.prefix.size());
+		for (int i = 0; i < 2; ++i) {
+			file.write(parts.tables[i], parts.tableBytes[i]);
+		}
+		file.write(parts.rngText.data(), parts.rngText.size());
+		if (!file) {
+			return false;
+		}
+	}
+	return RenameReplacing(temporaryPath, path);
+}
+
+bool Agent::TakeSnapshot(Snapshot& snapshot) const {
+	CheckpointParts parts;
+	if (!GetCheckpointParts(parts)) {
+		return false;
+	}
+	size_t size = parts.prefix.size() + parts.tableBytes[0] + parts.tableBytes[1] + parts.rngText.size();
+	snapshot.data.resize(size);
+	char* out = snapshot.data.data();
+	std::memcpy(out, parts.prefix.data(), parts.prefix.size());
+	out += parts.prefix.size();
+	for (int i = 0; i < 2; ++i) {
+		std::memcpy(out, parts.tables[i], parts.tableBytes[i]);
+		out += parts.tableBytes[i];
+	}
+	std::memcpy(out, parts.rngText.data(), parts.rngText.size());
+	return true;
+}
+
+bool Agent::Snapshot::Write(const std::string& path) const {
+	// write next to the target and rename, so the previous checkpoint stays
+	// valid until the new one is complete
+	std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		file.write(data.data(), data.size());
+		if (!file) {
+			return false;
+		}
+	}
+	return RenameReplacing(temporaryPath, path);
+}
+
+bool Agent::LoadCheckpoint(const std::string& path) {
+	assert(!sharedTables);
+	auto file = std::make_unique<MappedFile>();
+	if (!file->Open(path) || file->GetSize() < sizeof(CheckpointHeader)) {
+		return false;
+	}
+	CheckpointHeader header;
+	std::memcpy(&header, file->GetData(), sizeof(header));
+	if (std::memcmp(header.magic, checkpointMagic, sizeof(header.magic)) != 0
+		|| header.version != checkpointVersion
+		|| header.headerSize != sizeof(CheckpointHeader)
+		|| header.storage > QUANTIZED
+		|| header.layout > TableLayout::MORTON
+		|| (size_t)header.width != width || (size_t)header.height != height
+		|| header.tableOffset % checkpointAlignment != 0
+		|| header.rngOffset < header.tableOffset + header.tableBytes
+		|| header.rngOffset + header.rngBytes > file->GetSize())
+	{
+		return false;
+	}
+	TableLayout fileLayout((TableLayout::eType)header.layout, header.width, header.height);
+	bool isInterleaved = header.storage == INTERLEAVED;
+	bool isQuantized = header.storage == QUANTIZED;
+	size_t itemBytes = isQuantized ? sizeof(QuantizedRecord) : sizeof(QItem) + sizeof(NItem);
+	if (header.tableSize != fileLayout.GetCapacity() || header.tableBytes != header.tableSize * itemBytes) {
+		return false;
+	}
+
+	std::istringstream rngState(std::string(file->GetData() + header.rngOffset, header.rngBytes));
+	std::mt19937 loadedRne;
+	RandomSource loadedRandom(RandomSource::MT19937, 0);
+	if (!(rngState >> loadedRne >> loadedRandom)) {
+		return false;
+	}
+
+	rne = loadedRne;
+	random = loadedRandom;
+	layoutType = fileLayout.GetType();
+	layout = fileLayout;
+	interleaved = isInterleaved;
+	quantized = isQuantized;
+	sparse = false;
+	tables = std::make_shared<Tables>(std::move(file), header.tableOffset, header.tableSize, isInterleaved, isQuantized);
+	AttachTables();
+	ResetModel();
+	return true;
+}
@@ -2,9 +2,17 @@
 
 #include <vector>
 #include <array>
+#include <atomic>
+#include <memory>
 #include <cstdint>
+#include <queue>
 #include <random>
+#include <string>
 #include "Util.h"
+#include "TableLayout.h"
+#include "SparseTable.h"
+#include "MappedFile.h"
+#include "Random.h"
 
 class Game;
 class Map;
@@ -15,18 +23,94 @@ class Map;
 ////////////////////////////////////////////////////////////////////////////////
 class Agent {
 	using real = double;
+public:
+	/// A checkpoint file in memory, see TakeSnapshot.
+	struct Snapshot {
+		std::vector<char> data; ///< Same bytes as written by SaveCheckpoint.
+		/// Write the snapshot as a checkpoint file. The file is replaced only
+		/// once it has been written completely.
+		/// \return False if the file can't be written.
+		bool Write(const std::string& path) const;
+	};
 public:
 	Agent();
 	~Agent() = default;
 
 	/// Set a gameing environment in which the agent acts.
+	/// Allocates and resets the Q and N tables, unless they are shared with
+	/// other agents, in which case they are kept as they are.
 	/// \param game The new environment of the agent.
 	void SetGame(Game* game);
+	/// Learn into the Q and N tables of another agent.
+	/// Agents sharing their tables can learn in parallel from different threads,
+	/// Hogwild style: Q values are written without locking, so concurrent
+	/// updates may overwrite each other, and N counts use atomic increments.
+	/// Call before SetGame, with an agent whose game has the same map size.
+	/// \param other The agent that owns the tables.
+	void ShareTables(Agent& other);
 	/// Reset the agent's learning progress.
 	void Reset();
+	/// Reseed the random engine used for exploration.
+	void SetSeed(size_t seed);
+	/// Select the random engine used for exploration.
+	/// MT19937 by default, which draws the same numbers as before engines
+	/// could be selected. The others take buffered floats from a
+	/// RandomSource. The engine is reseeded with the latest seed.
+	void SetRandomEngine(RandomSource::eEngine engine);
+	/// Enable planning with a learned model (Dyna-Q, prioritized sweeping).
+	/// The agent records the outcomes it has seen for each (state, action),
+	/// and after each real step it performs a number of full backups on the
+	/// recorded model. The backups are taken from a priority queue ordered by
+	/// the Bellman error, and the predecessors of an updated state are queued
+	/// in turn. Takes effect on the next SetGame.
+	/// \param numSteps Number of backups after each real step, 0 disables planning.
+	/// \param threshold Smallest Bellman error that is worth queueing.
+	void SetPlanning(int numSteps, float threshold = 1e-4f);
+	/// Set the memory order of the Q and N tables, see TableLayout.
+	/// Takes effect on the next SetGame.
+	void SetLayout(TableLayout::eType layout);
+	/// Store the Q and N items of a state together in one 32 byte record,
+	/// two states per cache line, instead of in two separate tables.
+	/// Step then also prefetches the records of the possible next states.
+	/// Takes effect on the next SetGame.
+	void SetInterleaved(bool interleaved);
+	/// Store Q values as 16 bit fixed point numbers and N counts as saturating
+	/// 16 bit counters, in one 16 byte record per state. Updates are still
+	/// computed in floating point, only the stored result is rounded. Q values
+	/// are limited to [-8, 8) with a resolution of 1/4096, which covers the
+	/// rewards of the game. Takes effect on the next SetGame.
+	void SetQuantized(bool quantized);
+	/// Store only the states that have been visited, in a hash table, instead
+	/// of dense tables over the whole map. Unvisited states read as zero. The
+	/// memory then grows with the explored area, at the cost of a hash lookup
+	/// per access. Overrides the layout, interleaving and quantization, and the
+	/// tables can't be shared. Takes effect on the next SetGame. The game's
+	/// compiled rules are still dense, see Game::SetCompiled.
+	void SetSparse(bool sparse);
+	/// Use the same planning, layout and storage settings as another agent.
+	/// Takes effect on the next SetGame.
+	void CopySettings(const Agent& other);
 
 	/// Perform one action in the environment.
 	void Step();
+	/// Selects the next action of the agent.
+	/// Uses a greedy strategy with a little random behaviour. Called by Step,
+	/// and advances the random engine the same way.
+	/// \param x The current x coordinate of the agent.
+	/// \param y The current y coordinate of the agent.
+	/// \return The next ideal action to perform.
+	eAction SelectNextStep(int x, int y);
+	/// Updates the tables with the outcome of an action, the same way as Step
+	/// after performing the action. Use it to learn from the experience of
+	/// another agent.
+	/// \param x The x coordinate of the state the action was taken in.
+	/// \param y The y coordinate of the state the action was taken in.
+	/// \param action The action.
+	/// \param newx The x coordinate of the resulting state.
+	/// \param newy The y coordinate of the resulting state.
+	/// \param reward The reward of the resulting state.
+	/// \param isOver Wether the game ended with the action.
+	void Learn(int x, int y, eAction action, int newx, int newy, float reward, bool isOver);
 	/// Start an episode.
 	/// An episode normally starts from the start field and ends when the agent
 	/// hits either the finish or a mine. Call everytime a new game has started.
@@ -50,29 +134,161 @@ public:
 	float GetQMax(int x, int y) const;
 
 	int GetNSum(int x, int y) const;
+	/// Get the number of times an action has been taken in a state.
+	/// \param x The x coordinate of the requested state.
+	/// \param y The y coordinate of the requested state.
+	/// \param action The action.
+	int GetN(int x, int y, eAction action) const;
+	/// Overwrite an item of the Q and N tables.
+	/// Use it to merge the tables of agents that learned separately.
+	/// \param x The x coordinate of the state.
+	/// \param y The y coordinate of the state.
+	/// \param action The action.
+	/// \param q The new utility.
+	/// \param n The new visit count.
+	void SetEntry(int x, int y, eAction action, float q, int n);
+	/// Get the memory used by the Q and N tables in bytes.
+	size_t GetTableMemoryUsage() const;
+
+	/// Write the Q and N tables, their layout and the state of the random
+	/// engine to a checkpoint file. The tables are written as they are in
+	/// memory, starting at a page boundary, see LoadCheckpoint.
+	/// The planning model is not saved. Sparse tables can't be saved.
+	/// \return False if the tables are sparse or the file can't be written.
+	bool SaveCheckpoint(const std::string& path) const;
+	/// Continue learning from a checkpoint written by SaveCheckpoint.
+	/// The file is mapped into memory and used as the tables directly, so
+	/// loading takes no time regardless of the size of the tables. Pages are
+	/// read on first access, and changes are copy-on-write, the file itself is
+	/// never modified. Call after SetGame, the layout and storage of the tables
+	/// are taken from the file. The planning model starts empty.
+	/// \return False if the file is invalid or of a different map size.
+	bool LoadCheckpoint(const std::string& path);
+	/// Copy the checkpoint of the agent into memory, to write it later from
+	/// another thread while the agent keeps learning. The memory of the
+	/// snapshot is reused, so taking it again costs a single copy.
+	/// \return False if the tables are sparse.
+	bool TakeSnapshot(Snapshot& snapshot) const;
 private:
-	/// Selects the next action of the agent.
-	/// Uses a greedy strategy with a little random behaviour.
-	/// \param x The current x coordinate of the agent.
-	/// \param y The current y coordinate of the agent.
-	/// \return The next ideal action to perform.
-	eAction SelectNextStep(int x, int y);
-	/// Indexing helper for Q table.
-	float& Q(int x, int y, eAction action);
-	/// Indexing helper for N table.
-	int& N(int x, int y, eAction action);
+	/// Records the outcome of a real step into the learned model, and queues
+	/// the (state, action) for planning. Then performs the planning backups.
+	void Plan(int x, int y, eAction action, int newx, int newy, float reward, bool isOver);
+	/// The expected Q of an action by the learned model.
+	float ModelTarget(int x, int y, eAction action) const;
+	/// Forget the learned model and the pending planning backups.
+	void ResetModel();
+	/// Queue the (state, action) if its Bellman error is high enough.
+	void QueueForPlanning(int x, int y, eAction action);
+	/// Indexing helper for Q table, sets an item.
+	void SetQ(int x, int y, eAction action, float value);
+	/// Indexing helper for N table, increments an item.
+	void IncrementN(int x, int y, eAction action);
+	/// Indexing helper for N table, sets an item.
+	void SetN(int x, int y, eAction action, int value);
+
+	/// Q values of a state.
+	using QItem = std::array<std::atomic<float>, 4>;
+	/// Visit counts of a state.
+	using NItem = std::array<std::atomic<int>, 4>;
+	/// The Q and N items of a state side by side.
+	struct alignas(32) Record {
+		QItem q;
+		NItem n;
+	};
+	/// The Q and N items of a state in 16 bit precision.
+	struct alignas(16) QuantizedRecord {
+		std::array<std::atomic<int16_t>, 4> q; ///< Fixed point, see quantizedScale.
+		std::array<std::atomic<uint16_t>, 4> n; ///< Saturates at the maximum.
+	};
+	static constexpr float quantizedScale = 4096.0f; ///< Stored value of Q = 1.
+
+	/// Storage of the Q and N tables, possibly shared between agents.
+	/// Entries are accessed with relaxed atomic loads and stores, which are
+	/// plain memory accesses on common hardware.
+	struct Tables {
+		Tables(size_t size, bool interleaved, bool quantized, bool sparse);
+		/// Use the tables stored in a mapped checkpoint.
+		/// \param offset Position of the tables in the file.
+		Tables(std::unique_ptr<MappedFile> file, size_t offset, size_t size, bool interleaved, bool quantized);
+		/// Get the number of bytes of the dense tables.
+		size_t GetBytes() const;
+		std::unique_ptr<QItem[]> Q; ///< Separate Q table, if not interleaved.
+		std::unique_ptr<NItem[]> N; ///< Separate N table, if not interleaved.
+		std::unique_ptr<Record[]> records; ///< Q and N together, if interleaved.
+		std::unique_ptr<QuantizedRecord[]> quantizedRecords; ///< Q and N together, if quantized.
+		std::unique_ptr<SparseTable> sparse; ///< Visited states only, if sparse.
+		std::unique_ptr<MappedFile> file; ///< Holds the dense tables instead of the arrays, if loaded.
+		char* q = nullptr; ///< First Q item of the dense tables.
+		char* n = nullptr; ///< First N item of the dense tables.
+		QuantizedRecord* quantized = nullptr; ///< First 16 bit record of the dense tables.
+		int strideShift = 4; ///< Log2 of the distance of items.
+		bool interleaved;
+		size_t size;
+	};
+
+	/// The pieces of a checkpoint file, in order.
+	struct CheckpointParts {
+		std::vector<char> prefix; ///< Header and padding.
+		const char* tables[2]; ///< The tables as in memory.
+		size_t tableBytes[2];
+		std::string rngText;
+	};
+	/// Collect the pieces of the checkpoint of the agent.
+	/// \return False if the tables are sparse.
+	bool GetCheckpointParts(CheckpointParts& parts) const;
+
+	/// Point Q_, N_, QN16_ or sparse_ to the current tables.
+	void AttachTables();
+	/// Get the Q item at a table index.
+	QItem& QAt(size_t index) const { return *reinterpret_cast<QItem*>(Q_ + (index << strideShift)); }
+	/// Get the N item at a table index.
+	NItem& NAt(size_t index) const { return *reinterpret_cast<NItem*>(N_ + (index << strideShift)); }
+
+	std::shared_ptr<Tables> tables; ///< Owns Q_ and N_.
+	TableLayout layout; ///< Maps states to items of Q_ and N_.
+	TableLayout::eType layoutType = TableLayout::ROW_MAJOR; ///< Layout to use on the next SetGame.
+	bool interleaved = false; ///< Wether Q and N items share records, to use on the next SetGame.
+	bool quantized = false; ///< Wether to use 16 bit records, on the next SetGame.
+	bool sparse = false; ///< Wether to use a hash table, on the next SetGame.
+	char* Q_ = nullptr; ///< Stores the utility of an action at a given state, items are 1 << strideShift bytes apart.
+	char* N_ = nullptr; ///< Stores the number an action has been used in a particular state, items are 1 << strideShift bytes apart.
+	int strideShift = 4; ///< Log2 of the distance of items, 4 for separate tables, 5 for interleaved records.
+	QuantizedRecord* QN16_ = nullptr; ///< Stores Q and N instead of Q_ and N_ in 16 bit precision.
+	SparseTable* sparse_ = nullptr; ///< Stores Q and N instead of the dense tables, keyed by y*width + x.
+	bool prefetchNext = false; ///< Wether Step prefetches the possible next states.
+	bool sharedTables = false; ///< Wether other agents learn into the same tables.
+
+	/// Outcomes of a (state, action) seen so far. There are at most three:
+	/// the intended move and a slip to either side.
+	struct ModelEntry {
+		int32_t next[3]; ///< Index of the destination field.
+		int32_t count[3]; ///< Number of times the destination was observed, 0 for unused slots.
+	};
+	/// An item of the planning queue.
+	struct PlanningItem {
+		float priority;
+		int x, y;
+		eAction action;
+		bool operator<(const PlanningItem& rhs) const { return priority < rhs.priority; }
+	};
 
-	std::vector<std::array<float, 4>> Q_; ///< Stores the utility of an action at a given state.
-	std::vector<std::array<int, 4>> N_; ///< Stores the number an action has been used in a particular state.
+	int planningSteps = 0; ///< Number of planning backups per real step.
+	float planningThreshold = 1e-4f; ///< Smallest Bellman error that is queued.
+	std::vector<ModelEntry> model; ///< Learned outcomes of each (state, action), action is the minor index.
+	std::vector<float> modelReward; ///< Learned reward of each field.
+	std::vector<uint8_t> modelTerminal; ///< Learned end of game flag of each field.
+	std::vector<float> priorities; ///< Current priority of each queued (state, action), 0 if not queued.
+	std::priority_queue<PlanningItem> planningQueue; ///< Pending backups, may contain outdated items.
 	size_t width = 0; ///< Width of the latest set game environment.
 	size_t height = 0; ///< Height of the latest set game environment.
 
 	Game* currentGame; ///< Current active game environment.
 	real totalReward; ///< The total reward collected during an episode.
 
-	std::mt19937 rne; ///< High quality random number engine.
+	std::mt19937 rne; ///< High quality random number engine, with MT19937.
 	std::uniform_real_distribution<real> rng_roll;
 	std::uniform_int_distribution<int> rng_action;
+	RandomSource random; ///< Buffered random numbers, with the other engines.
 
 	static constexpr real alpha = 0.2f; ///< Learning rate constant.
 	static constexpr real gamma = 0.98f; ///< Discount constant.
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// Blocks a fixed number of threads until all of them have arrived.
+/// Can be reused right away for the next round.
+////////////////////////////////////////////////////////////////////////////////
+class Barrier {
+public:
+	/// \param numThreads The number of threads that meet at the barrier.
+	explicit Barrier(int numThreads) : numThreads(numThreads) {}
+
+	/// Wait until all threads have called Wait.
+	void Wait() {
+		std::unique_lock<std::mutex> lk(mtx);
+		int currentGeneration = generation;
+		if (++numArrived == numThreads) {
+			numArrived = 0;
+			++generation;
+			cv.notify_all();
+		}
+		else {
+			cv.wait(lk, [&] { return generation != currentGeneration; });
+		}
+	}
+private:
+	std::mutex mtx;
+	std::condition_variable cv;
+	int numThreads;
+	int numArrived = 0;
+	int generation = 0;
+};
@@ -0,0 +1,110 @@
+#include "CheckpointScheduler.h"
+
+
+CheckpointScheduler::CheckpointScheduler(const std::string& path, int episodeInterval, double secondsInterval) :
+	path(path),
+	episodeInterval(episodeInterval),
+	secondsInterval(secondsInterval),
+	lastTime(Clock::now())
+{
+	for (auto& buffer : buffers) {
+		buffer = std::make_unique<Agent::Snapshot>();
+		freeBuffers.push_back(buffer.get());
+	}
+	writer = std::thread([this] { WriterLoop(); });
+}
+
+
+CheckpointScheduler::~CheckpointScheduler() {
+	{
+		std::lock_guard<std::mutex> lk(mtx);
+		stop = true;
+	}
+	cv.notify_all();
+	writer.join();
+}
+
+
+bool CheckpointScheduler::EndEpisode(const Agent& agent) {
+	++numEpisodes;
+	bool due = episodeInterval > 0 && numEpisodes - lastEpisode >= episodeInterval;
+	if (!due && secondsInterval > 0) {
+		due = std::chrono::duration<double>(Clock::now() - lastTime).count() >= secondsInterval;
+	}
+	if (due) {
+		Checkpoint(agent);
+	}
+	return due;
+}
+
+
+void CheckpointScheduler::Checkpoint(const Agent& agent) {
+	auto start = Clock::now();
+
+	// with both buffers busy, the writer is behind, wait for it
+	Agent::Snapshot* buffer;
+	{
+		std::unique_lock<std::mutex> lk(mtx);
+		cv.wait(lk, [this] { return !freeBuffers.empty(); });
+		buffer = freeBuffers.back();
+		freeBuffers.pop_back();
+	}
+
+	bool taken = agent.TakeSnapshot(*buffer);
+	auto end = Clock::now();
+	lastEpisode = numEpisodes;
+	lastTime = end;
+
+	std::lock_guard<std::mutex> lk(mtx);
+	records.push_back({ numEpisodes, std::chrono::duration<double>(end - start).count(), 0.0, false });
+	if (!taken) {
+		freeBuffers.push_back(buffer);
+		return;
+	}
+	// the writer hasn't started the previous snapshot yet, the new one replaces it
+	if (pending) {
+		freeBuffers.push_back(pending);
+	}
+	pending = buffer;
+	pendingRecord = records.size() - 1;
+	cv.notify_all();
+}
+
+
+void CheckpointScheduler::Flush() {
+	std::unique_lock<std::mutex> lk(mtx);
+	cv.wait(lk, [this] { return !pending && !writing; });
+}
+
+
+auto CheckpointScheduler::GetRecords() const -> std::vector<Record> {
+	std::lock_guard<std::mutex> lk(mtx);
+	return records;
+}
+
+
+void CheckpointScheduler::WriterLoop() {
+	std::unique_lock<std::mutex> lk(mtx);
+	while (true) {
+		cv.wait(lk, [this] { return pending || stop; });
+		if (!pending) {
+			return;
+		}
+		Agent::Snapshot* buffer = pending;
+		size_t record = pendingRecord;
+		pending = nullptr;
+		writing = true;
+
+		lk.unlock();
+		auto start = Clock::now();
+		bool written = buffer->Write(path);
+		auto end = Clock::now();
+		lk.lock();
+
+		records[record].writeSeconds = std::chrono::duration<double>(end - start).count();
+		records[record].written = written;
+		freeBuffers.push_back(buffer);
+		writing = false;
+		cv.notify_all();
+	}
+}
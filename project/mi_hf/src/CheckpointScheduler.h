@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Agent.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// Writes periodic checkpoints of an agent while it keeps learning.
+/// When a checkpoint is due, the tables are copied into one of two snapshot
+/// buffers, and a background thread writes the snapshot to disk. The learner
+/// only stalls for the copy, or if both buffers are still busy with earlier
+/// checkpoints, until one of them is free.
+////////////////////////////////////////////////////////////////////////////////
+class CheckpointScheduler {
+public:
+	/// Timing of a checkpoint.
+	struct Record {
+		int episode; ///< Number of episodes played before the checkpoint.
+		double stallSeconds; ///< Time the learner was blocked, waiting and copying.
+		double writeSeconds; ///< Time the writer thread spent on the file.
+		bool written; ///< Wether the file was written successfully.
+	};
+public:
+	/// \param path The checkpoint file, overwritten by every checkpoint.
+	/// \param episodeInterval Number of episodes between checkpoints, 0 for none.
+	/// \param secondsInterval Wall time between checkpoints, 0 for none.
+	CheckpointScheduler(const std::string& path, int episodeInterval, double secondsInterval);
+	/// Waits for the pending checkpoints to be written.
+	~CheckpointScheduler();
+	CheckpointScheduler(const CheckpointScheduler&) = delete;
+	CheckpointScheduler& operator=(const CheckpointScheduler&) = delete;
+
+	/// Call after every episode of the learner.
+	/// Takes a checkpoint if either interval has elapsed since the last one.
+	/// \return True if a checkpoint was taken.
+	bool EndEpisode(const Agent& agent);
+	/// Take a checkpoint right away.
+	void Checkpoint(const Agent& agent);
+	/// Wait until every checkpoint taken so far is written.
+	void Flush();
+
+	/// Get the timing of the checkpoints taken so far.
+	/// The write times of pending checkpoints are not final until Flush.
+	std::vector<Record> GetRecords() const;
+private:
+	using Clock = std::chrono::steady_clock;
+
+	/// Writes the queued snapshots until stopped.
+	void WriterLoop();
+
+	std::string path;
+	int episodeInterval;
+	double secondsInterval;
+	int numEpisodes = 0;
+	int lastEpisode = 0; ///< Episode of the last checkpoint.
+	Clock::time_point lastTime; ///< Time of the last checkpoint.
+
+	std::unique_ptr<Agent::Snapshot> buffers[2];
+	std::vector<Agent::Snapshot*> freeBuffers; ///< Buffers the learner can copy into.
+	Agent::Snapshot* pending = nullptr; ///< Buffer waiting to be written.
+	size_t pendingRecord = 0; ///< Index of the record of the pending buffer.
+	bool writing = false; ///< Wether the writer thread is busy with a buffer.
+	bool stop = false;
+	std::vector<Record> records;
+	mutable std::mutex mtx;
+	std::condition_variable cv;
+	std::thread writer;
+};
@@ -0,0 +1,80 @@
+#include "DeltaStream.h"
+#include "Agent.h"
+
+#include <algorithm>
+
+
+DeltaStream::DeltaStream(size_t capacity) : ring(capacity) {}
+
+
+void DeltaStream::Reset(int width, int height) {
+	this->width = width;
+	this->height = height;
+	ring.Reset(ring.GetCapacity());
+	snapshots.Reset(width, height);
+	resyncRequested.store(false);
+	dirtyBits.assign(((size_t)width * height + 63) / 64, 0);
+	dirtyCells.clear();
+	numMarkers = 0;
+}
+
+
+bool DeltaStream::Flush(const Agent& agent, bool qMax) {
+	bool resync = resyncRequested.load();
+	if (!resync) {
+		for (uint32_t cell : dirtyCells) {
+			int x = (int)(cell % width);
+			int y = (int)(cell / width);
+			float value = qMax ? agent.GetQMax(x, y) : (float)agent.GetNSum(x, y);
+			if (!ring.Push(Delta{ cell, value })) {
+				// the rest of the changes are lost, a snapshot replaces them
+				resyncRequested.store(true);
+				resync = true;
+				break;
+			}
+		}
+	}
+	for (uint32_t cell : dirtyCells) {
+		dirtyBits[cell >> 6] = 0;
+	}
+	dirtyCells.clear();
+	if (!resync) {
+		return true;
+	}
+
+	// the snapshot covers everything before its marker
+	if (ring.IsFull()) {
+		return false;
+	}
+	resyncRequested.store(false);
+	snapshots.Publish(agent, qMax);
+	ring.Push(Delta{ resyncMarker, 0.0f });
+	return true;
+}
+
+
+size_t DeltaStream::Update(float* values, float& min, float& max) {
+	size_t numPatched = 0;
+	Delta delta;
+	while (ring.Pop(delta)) {
+		if (delta.cell != resyncMarker) {
+			values[delta.cell] = delta.value;
+			min = std::min(min, delta.value);
+			max = std::max(max, delta.value);
+			++numPatched;
+			continue;
+		}
+		// a newer snapshot has been published if the versions differ, its
+		// own marker comes later
+		++numMarkers;
+		const SnapshotChannel::Buffer& snapshot = snapshots.Acquire();
+		if (snapshot.version == numMarkers) {
+			std::copy(snapshot.values.begin(), snapshot.values.end(), values);
+			min = snapshot.min;
+			max = snapshot.max;
+			numPatched += snapshot.values.size();
+		}
+		snapshots.Release();
+	}
+	return numPatched;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "SnapshotChannel.h"
+#include "SpscRing.h"
+
+class Agent;
+
+////////////////////////////////////////////////////////////////////////////////
+/// Streams the changes of the state values of an agent from the teaching
+/// thread to the display, so that updating the display costs in proportion
+/// to the number of changed states instead of the area of the map.
+///
+/// The teaching thread marks the states whose Q or N items it changed in a
+/// dirty bitmap. On Flush, it pushes the new value of each dirty state into a
+/// lock-free ring, and clears the bitmap. The display drains the ring and
+/// patches its own copy of the values.
+/// A full snapshot through a SnapshotChannel is sent instead when the display
+/// asks for one, for example because it switched between Q and N values, or
+/// when the ring overflows. A marker in the ring tells the display where the
+/// snapshot belongs among the changes.
+/// There is a single producer and a single consumer thread.
+////////////////////////////////////////////////////////////////////////////////
+class DeltaStream {
+public:
+	/// The new value of a state.
+	struct Delta {
+		uint32_t cell; ///< y*width + x, or resyncMarker.
+		float value;
+	};
+	/// The cell of a Delta that marks a published snapshot.
+	static constexpr uint32_t resyncMarker = UINT32_MAX;
+public:
+	/// \param capacity Number of changes the ring holds.
+	explicit DeltaStream(size_t capacity = 65536);
+
+	/// Set the size of the map, and start with all values zero.
+	/// Call while neither the producer nor the consumer use the stream.
+	void Reset(int width, int height);
+
+	/// Producer: mark the state at a cell as changed.
+	/// \param cell y*width + x.
+	void MarkDirty(int cell) {
+		uint64_t bit = uint64_t(1) << (cell & 63);
+		uint64_t& word = dirtyBits[cell >> 6];
+		if (!(word & bit)) {
+			word |= bit;
+			dirtyCells.push_back((uint32_t)cell);
+		}
+	}
+	/// Producer: send a snapshot if one is due, or the values of the states
+	/// changed since the last Flush otherwise.
+	/// \param qMax See ComputeStateValues.
+	/// \return False if a snapshot is due but the ring is full, try again later.
+	bool Flush(const Agent& agent, bool qMax);
+
+	/// Consumer: ask for a full snapshot on the next Flush.
+	void RequestResync() { resyncRequested.store(true); }
+	/// Consumer: apply the changes sent so far to the display's values.
+	/// \param values [in, out] width*height values, row-major.
+	/// \param min [in, out] The lowest value, only grows apart between snapshots.
+	/// \param max [in, out] The highest value, only grows apart between snapshots.
+	/// \return The number of cells patched, width*height for a snapshot.
+	size_t Update(float* values, float& min, float& max);
+private:
+	SpscRing<Delta> ring;
+	SnapshotChannel snapshots;
+	int width = 0;
+	int height = 0;
+	std::atomic<bool> resyncRequested{ false }; ///< Set by the consumer, or by the producer on overflow.
+	std::vector<uint64_t> dirtyBits; ///< One bit per cell, producer only.
+	std::vector<uint32_t> dirtyCells; ///< The cells with a bit set, producer only.
+	uint64_t numMarkers = 0; ///< Markers seen by the consumer, the version of the matching snapshot.
+};
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <random>
+#include "Util.h"
+#include "Map.h"
+#include "TransitionModel.h"
+#include "Random.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// Game and agent for a map size known at compile time.
+/// They follow the same rules and learn the same way as Game and Agent on a
+/// row-major, separate table, without planning, and given the same seeds they
+/// play exactly the same episodes. With the width and height being constants,
+/// the cell to coordinate divisions become multiplications, the index
+/// arithmetic folds into constant strides, and the tables are plain arrays
+/// inside the objects, without any storage options to branch on.
+/// The objects are large, allocate them on the heap for bigger maps.
+/// The map is only read to compile the rules, so its fixed size counterpart
+/// is the compiled FixedModel.
+////////////////////////////////////////////////////////////////////////////////
+
+/// The compiled rules of a map of W x H fields, see TransitionModel.
+template <int W, int H>
+class FixedModel {
+public:
+	static constexpr int width = W;
+	static constexpr int height = H;
+	static constexpr int numCells = W * H;
+	using Transition = TransitionModel::Transition;
+public:
+	/// Compile the model of a map.
+	/// \return False if the map is not of W x H fields.
+	bool Build(const Map& map) {
+		if (map.GetWidth() != W || map.GetHeight() != H) {
+			return false;
+		}
+		TransitionModel model(map);
+		for (int cell = 0; cell < numCells; ++cell) {
+			for (int action = 0; action < 4; ++action) {
+				transitions[cell * 4 + action] = model(cell, (eAction)action);
+			}
+			rewards[cell] = model.Reward(cell);
+		}
+		return true;
+	}
+
+	/// Get the outcomes of an action taken on a field.
+	const Transition& operator()(int cell, eAction action) const {
+		assert(0 <= cell && cell < numCells);
+		return transitions[cell * 4 + action];
+	}
+	/// Get the reward of a field.
+	float Reward(int cell) const { return rewards[cell]; }
+private:
+	std::array<Transition, numCells * 4> transitions; ///< Outcomes of each (field, action), action is the minor index.
+	std::array<float, numCells> rewards; ///< Reward of each field.
+};
+
+
+/// Game on a map of W x H fields, see Game.
+template <int W, int H>
+class FixedGame {
+public:
+	using Model = FixedModel<W, H>;
+public:
+	FixedGame() : random(RandomSource::MT19937, std::mt19937::default_seed) {}
+
+	/// The agent performs an action.
+	/// \return True, if the game is over (finish or mine), false otherwise.
+	bool PerformAction(eAction action) {
+		const auto& transition = (*model)(pos, action);
+		int outcome = TransitionModel::Outcome(random.Uniform());
+
+		pos = transition.next[outcome];
+		reward = transition.reward[outcome];
+		ended = transition.terminal[outcome] != 0;
+		return ended;
+	}
+	/// Get the reward of the current field.
+	float GetCurrentReward() const { return reward; }
+	/// Get the current field's x coordinate.
+	int GetCurrentX() const { return pos % W; }
+	/// Get the current field's y coordinate.
+	int GetCurrentY() const { return pos / W; }
+	/// Get the current field's index, y*W + x.
+	int GetCurrentCell() const { return pos; }
+
+	/// Start a new game.
+	/// Puts the agent to the start position.
+	void NewGame() {
+		pos = 0;
+		reward = model ? model->Reward(pos) : 0;
+		ended = false;
+	}
+	/// Get wether the game has ended.
+	bool Ended() const { return ended; }
+	/// Reseed the random engine responsible for the agent's slipping.
+	void SetSeed(size_t seed) { random.SetSeed((std::mt19937::result_type)seed); }
+	/// Select the random engine responsible for the agent's slipping.
+	void SetRandomEngine(RandomSource::eEngine engine) { random.SetEngine(engine); }
+
+	/// Set the compiled rules of the game. The model must outlive the game.
+	void SetModel(const Model* model) {
+		this->model = model;
+		pos = 0;
+		reward = model ? model->Reward(pos) : 0;
+	}
+	/// Get the compiled rules of the game.
+	const Model* GetModel() const { return model; }
+private:
+	const Model* model = nullptr; ///< Compiled rules of the map.
+	int pos = 0; ///< Index of the agent's current field.
+	float reward = 0; ///< Reward of the agent's current field.
+	bool ended = false; ///< Wether the game has ended.
+	RandomSource random; ///< Rolls for slipping.
+};
+
+
+/// Q learning agent on a map of W x H fields, see Agent.
+template <int W, int H>
+class FixedAgent {
+	using real = double;
+public:
+	using Game = FixedGame<W, H>;
+	static constexpr int numCells = W * H;
+public:
+	FixedAgent() :
+		rne(Seed()),
+		rng_roll(0.0f, 1.0f),
+		rng_action(0, 3),
+		random(RandomSource::MT19937, 0)
+	{
+		random.SetSeed(rne());
+		Reset();
+	}
+
+	/// Set the gaming environment in which the agent acts.
+	/// The tables are not reset, use Reset for that.
+	void SetGame(Game* game) { currentGame = game; }
+	/// Reset the agent's learning progress.
+	void Reset() {
+		for (auto& q : Q) {
+			q.fill(0.0f);
+		}
+		for (auto& n : N) {
+			n.fill(0);
+		}
+	}
+	/// Reseed the random engine used for exploration.
+	void SetSeed(size_t seed) {
+		rne.seed((std::mt19937::result_type)seed);
+		random.SetSeed(seed);
+	}
+	/// Select the random engine used for exploration, see Agent.
+	void SetRandomEngine(RandomSource::eEngine engine) { random.SetEngine(engine); }
+
+	/// Perform one action in the environment.
+	void Step() {
+		int cell = currentGame->GetCurrentCell();
+		eAction action = SelectNextStep(cell);
+		real Qold = Q[cell][action];
+
+		bool isOver = currentGame->PerformAction(action);
+		++N[cell][action];
+
+		real reward = currentGame->GetCurrentReward();
+		int next = currentGame->GetCurrentCell();
+		real Qmax = GetQMax(next);
+
+		if (!isOver) {
+			Q[cell][action] = (float)(Qold + alpha*(reward + gamma*Qmax - Qold));
+		}
+		else {
+			Q[next].fill((float)reward);
+			Q[cell][action] = (float)(Qold + alpha*(reward - Qold));
+		}
+
+		totalReward += reward;
+	}
+	/// Start an episode.
+	void StartEpisode() { totalReward = 0; }
+	/// Ends an episode.
+	/// \return The total reward collected during the episode.
+	float EndEpisode() { return (float)totalReward; }
+
+	/// Get an item from the agent's Q(state, action) table.
+	float GetQ(int x, int y, eAction action) const { return Q[y*W + x][action]; }
+	/// Get the best action's value from the Q table.
+	float GetQMax(int x, int y) const { return GetQMax(y*W + x); }
+	/// Get the number of times an action has been taken in a state.
+	int GetN(int x, int y, eAction action) const { return N[y*W + x][action]; }
+	/// Get the memory used by the Q and N tables in bytes.
+	static constexpr size_t GetTableMemoryUsage() { return sizeof(Q) + sizeof(N); }
+private:
+	/// Selects the next action of the agent, same as Agent::SelectNextStep.
+	eAction SelectNextStep(int cell) {
+		const bool buffered = random.GetEngine() != RandomSource::MT19937;
+		real roll = buffered ? random.Uniform() : rng_roll(rne);
+		if (roll > explorerness) {
+			eAction action = UP;
+			float utility = -std::numeric_limits<float>::infinity();
+			for (int i = 0; i < 4; i++) {
+				if (utility < Q[cell][i]) {
+					utility = Q[cell][i];
+					action = (eAction)i;
+				}
+			}
+			return action;
+		}
+		return buffered ? (eAction)(int)(random.Uniform() * 4) : (eAction)rng_action(rne);
+	}
+	float GetQMax(int cell) const {
+		const auto& q = Q[cell];
+		return std::max(std::max(q[0], q[1]), std::max(q[2], q[3]));
+	}
+
+	std::array<std::array<float, 4>, numCells> Q; ///< Utility of each action at each state, row-major.
+	std::array<std::array<int, 4>, numCells> N; ///< Number of times each action was taken at each state.
+
+	Game* currentGame = nullptr; ///< Current active game environment.
+	real totalReward = 0; ///< The total reward collected during an episode.
+
+	std::mt19937 rne; ///< High quality random number engine, with MT19937.
+	std::uniform_real_distribution<real> rng_roll;
+	std::uniform_int_distribution<int> rng_action;
+	RandomSource random; ///< Buffered random numbers, with the other engines.
+
+	static constexpr real alpha = 0.2f; ///< Learning rate constant.
+	static constexpr real gamma = 0.98f; ///< Discount constant.
+	static constexpr real explorerness = 0.04f;
+};
@@ -2,86 +2,27 @@
 #include "Game.h"
 #include "Util.h"
 
-Game::Game() {
+Game::Game() : random(RandomSource::MT19937, std::mt19937::default_seed) {
 	map = nullptr;
-	posx = posy = 0;
+	pos = 0;
+	reward = 0;
+	ended = false;
 }
 
 
 bool Game::PerformAction(eAction action) {
-	std::uniform_real_distribution<float> rng(0, 1);
-	float roll = rng(rne);
-	if (roll < 0.1) {
-		// random right turn
-		switch (action)
-		{
-			case UP:
-				action = RIGHT;
-				break;
-			case DOWN:
-				action = LEFT;
-				break;
-			case LEFT:
-				action = UP;
-				break;
-			case RIGHT:
-				action = DOWN;
-				break;
-		}
-	}
-	else if (roll < 0.2) {
-		// random left turn
-		switch (action)
-		{
-			case UP:
-				action = LEFT;
-				break;
-			case DOWN:
-				action = RIGHT;
-				break;
-			case LEFT:
-				action = DOWN;
-				break;
-			case RIGHT:
-				action = UP;
-				break;
-		}
-	}
-
-
-	int deltax, deltay;
-	if (action == UP)
-		deltay = 1;
-	else if (action == DOWN)
-		deltay = -1;
-	else 
-		deltay = 0;
-
-	if (action == RIGHT)
-		deltax = 1;
-	else if (action == LEFT)
-		deltax = -1;
-	else
-		deltax = 0;
-
-	int newx = posx + deltax;
-	int newy = posy + deltay;
-
-	if (newx < 0 || map->GetWidth() <= newx || newy < 0 || map->GetHeight() <= newy) {
-		return ended;
-	}
-	if ((*map)(newx, newy).type == Map::Field::WALL) {
+	if (!model) {
+		int outcome = TransitionModel::Outcome(random.Uniform());
+		pos = TransitionModel::Next(*map, pos, action, outcome);
+		reward = CellReward(pos, ended);
 		return ended;
 	}
-	if ((*map)(newx, newy).type == Map::Field::MINE) {
-		ended = true;
-	}
-	if ((*map)(newx, newy).type == Map::Field::FINISH) {
-		ended = true;
-	}
+	const auto& transition = (*model)(pos, action);
+	int outcome = TransitionModel::Outcome(random.Uniform());
 
-	posx = newx;
-	posy = newy;
+	pos = transition.next[outcome];
+	reward = transition.reward[outcome];
+	ended = transition.terminal[outcome] != 0;
 	return ended;
 }
 
@@ -89,20 +30,21 @@ float Game::GetCurrentReward() const {
 	if (!map) {
 		return 0;
 	}
-	return (*map)(posx, posy).Reward();
+	return reward;
 }
 
 int Game::GetCurrentX() const {
-	return posx;
+	return map ? pos % map->GetWidth() : 0;
 }
 
 int Game::GetCurrentY() const {
-	return posy;
+	return map ? pos / map->GetWidth() : 0;
 }
 
 void Game::NewGame() {
-	posx = 0;
-	posy = 0;
+	pos = 0;
+	bool terminal;
+	reward = CellReward(pos, terminal);
 	ended = false;
 }
 
@@ -110,6 +52,38 @@ bool Game::Ended() {
 	return ended;
 }
 
+void Game::SetSeed(size_t seed) {
+	random.SetSeed((std::mt19937::result_type)seed);
+}
+
+void Game::SetRandomEngine(RandomSource::eEngine engine) {
+	random.SetEngine(engine);
+}
+
 void Game::SetMap(Map* map) {
+	SetMap(map, map && compiled ? std::make_shared<const TransitionModel>(*map) : nullptr);
+}
+
+void Game::SetMap(Map* map, std::shared_ptr<const TransitionModel> model) {
 	this->map = map;
+	this->model = std::move(model);
+	if (map && pos >= map->GetWidth() * map->GetHeight()) {
+		pos = 0;
+	}
+	bool terminal;
+	reward = CellReward(pos, terminal);
+}
+
+float Game::CellReward(int cell, bool& terminal) const {
+	if (model) {
+		terminal = model->Terminal(cell);
+		return model->Reward(cell);
+	}
+	if (!map) {
+		terminal = false;
+		return 0;
+	}
+	Map::Field::eType type = map->GetType(cell % map->GetWidth(), cell / map->GetWidth());
+	terminal = type == Map::Field::MINE || type == Map::Field::FINISH;
+	return Map::Field{ type }.Reward();
 }
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <random>
+#include <memory>
 #include "Util.h"
+#include "TransitionModel.h"
+#include "Random.h"
 
 
 class Map;
@@ -31,24 +34,49 @@ public:
 	int GetCurrentX() const;
 	/// Get the current field's y coordinate.
 	int GetCurrentY() const;
+	/// Get the current field's index, y*width + x.
+	int GetCurrentCell() const { return pos; }
 
 	/// Start a new game.
 	/// Puts the agent to the start position.
 	void NewGame();
 	/// Get wether the game has ended.
 	bool Ended();
+	/// Reseed the random engine responsible for the agent's slipping.
+	void SetSeed(size_t seed);
+	/// Select the random engine responsible for the agent's slipping.
+	/// MT19937 by default. The engine is reseeded with the latest seed.
+	void SetRandomEngine(RandomSource::eEngine engine);
+
+	/// Set wether the next SetMap compiles the map into a TransitionModel.
+	/// Without a model, the outcome of each action is computed from the map,
+	/// which is slower, but takes no memory beyond the map, for huge maps that
+	/// are mostly not visited. The games are the same either way.
+	void SetCompiled(bool compiled) { this->compiled = compiled; }
 
 	/// Set the map of the game.
-	/// See Map for more.
+	/// Compiles the map into a TransitionModel, unless disabled with
+	/// SetCompiled, so set it again after the map has been modified. See Map
+	/// for more.
 	void SetMap(Map* map);
+	/// Set the map of the game along with its already compiled model.
+	/// Lets many games share the same model.
+	void SetMap(Map* map, std::shared_ptr<const TransitionModel> model);
 	/// Get the currently set map.
 	Map* GetMap() { return map; }
 	/// Get the currently set map.
 	const Map* GetMap() const { return map; }
+	/// Get the compiled model of the current map, null if not compiled.
+	const std::shared_ptr<const TransitionModel>& GetModel() const { return model; }
 private:
+	/// Get the reward of a field, and wether the game ends there.
+	float CellReward(int cell, bool& terminal) const;
+
 	Map* map; ///< Current active map.
-	int posx; ///< Agent's current x coordinate.
-	int posy; ///< Agent's current y coordinate.
+	std::shared_ptr<const TransitionModel> model; ///< Compiled rules of the current map.
+	int pos; ///< Index of the agent's current field.
+	float reward; ///< Reward of the agent's current field.
 	bool ended; ///< Wether the game has ended.
-	std::mt19937 rne;
+	bool compiled = true; ///< Wether to compile the map on SetMap.
+	RandomSource random; ///< Rolls for slipping.
 };
\ No newline at end of file
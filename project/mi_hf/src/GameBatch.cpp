@@ -0,0 +1,87 @@
+#include "Map.h"
+#include "GameBatch.h"
+
+#include <cassert>
+
+
+namespace {
+
+inline uint32_t XorShift32(uint32_t& state) {
+	uint32_t x = state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	state = x;
+	return x;
+}
+
+}
+
+
+GameBatch::GameBatch(size_t size, size_t seed) :
+	map(nullptr),
+	pos(size, 0),
+	ended(size, 0),
+	rngState(size)
+{
+	SetSeed(seed);
+}
+
+
+void GameBatch::PerformActions(const eAction* actions, float* rewards, uint8_t* done) {
+	assert(model);
+	const TransitionModel& transitions = *model;
+	const size_t size = GetSize();
+
+	for (size_t i = 0; i < size; ++i) {
+		if (ended[i]) {
+			rewards[i] = 0.0f;
+			done[i] = 1;
+			continue;
+		}
+
+		// 24 random bits to [0, 1)
+		float roll = (XorShift32(rngState[i]) >> 8) * (1.0f / 16777216.0f);
+		const auto& transition = transitions(pos[i], actions[i]);
+		int outcome = TransitionModel::Outcome(roll);
+
+		pos[i] = transition.next[outcome];
+		rewards[i] = transition.reward[outcome];
+		ended[i] = transition.terminal[outcome];
+		done[i] = ended[i];
+	}
+}
+
+
+void GameBatch::NewGames() {
+	for (size_t i = 0; i < GetSize(); ++i) {
+		NewGame(i);
+	}
+}
+
+
+void GameBatch::NewGame(size_t index) {
+	assert(index < GetSize());
+	pos[index] = 0;
+	ended[index] = 0;
+}
+
+
+void GameBatch::SetSeed(size_t seed) {
+	for (size_t i = 0; i < GetSize(); ++i) {
+		// scramble the seed so that neighbouring games get unrelated streams
+		uint64_t state = (uint64_t)seed + i;
+		rngState[i] = (uint32_t)SplitMix64(state) | 1u; // xorshift state must not be zero
+	}
+}
+
+
+void GameBatch::SetMap(const Map* map) {
+	SetMap(map, map ? std::make_shared<const TransitionModel>(*map) : nullptr);
+}
+
+
+void GameBatch::SetMap(const Map* map, std::shared_ptr<const TransitionModel> model) {
+	this->map = map;
+	this->model = std::move(model);
+}
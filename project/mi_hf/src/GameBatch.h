@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include "Util.h"
+#include "TransitionModel.h"
+
+
+class Map;
+
+////////////////////////////////////////////////////////////////////////////////
+/// A batch of independent 'mines' games played on the same map.
+/// The rules are the same as for Game, but the state of the games is stored as
+/// struct of arrays, and all the games are stepped with a single call. Each
+/// game has its own small random engine for the slipping, so the games don't
+/// depend on each other.
+/// Games that have already ended are not moved, and yield zero reward until
+/// they are restarted.
+////////////////////////////////////////////////////////////////////////////////
+class GameBatch {
+public:
+	/// Create a batch of games.
+	/// \param size The number of games in the batch.
+	/// \param seed Seed of the games' random engines.
+	GameBatch(size_t size, size_t seed = Seed());
+	~GameBatch() = default;
+
+	/// Every game performs the corresponding action.
+	/// \param actions Array of size GetSize(), the action of each game.
+	/// \param rewards [output] Array of size GetSize(), the reward of the field
+	///		each game stands on after the action. Zero for already ended games.
+	/// \param done [output] Array of size GetSize(), non-zero for the games that
+	///		are over (finish or mine).
+	void PerformActions(const eAction* actions, float* rewards, uint8_t* done);
+
+	/// Start a new game for every game in the batch.
+	void NewGames();
+	/// Start a new game for a single game in the batch.
+	/// \param index Index of the game.
+	void NewGame(size_t index);
+
+	/// Reseed the random engines of the games.
+	void SetSeed(size_t seed);
+	/// Set the map of the games.
+	/// Compiles the map into a TransitionModel. See Map for more.
+	void SetMap(const Map* map);
+	/// Set the map of the games along with its already compiled model.
+	void SetMap(const Map* map, std::shared_ptr<const TransitionModel> model);
+	/// Get the currently set map.
+	const Map* GetMap() const { return map; }
+
+	/// Get the number of games in the batch.
+	size_t GetSize() const { return pos.size(); }
+	/// Get the field indices (y*width + x) of the games, an array of size GetSize().
+	const int32_t* GetCurrentCell() const { return pos.data(); }
+	/// Get wether the games have ended, an array of size GetSize().
+	const uint8_t* Ended() const { return ended.data(); }
+private:
+	const Map* map; ///< Current active map.
+	std::shared_ptr<const TransitionModel> model; ///< Compiled rules of the current map.
+	std::vector<int32_t> pos; ///< Indices of the agents' current fields.
+	std::vector<uint8_t> ended; ///< Wether the games have ended.
+	std::vector<uint32_t> rngState; ///< State of the per-game xorshift engines.
+};
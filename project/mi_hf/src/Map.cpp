@@ -1,6 +1,7 @@
 #include "Util.h"
 #include "Map.h"
 
+#include <algorithm>
 #include <cassert>
 #include <ctime>
 
@@ -14,18 +15,17 @@ Map::~Map() {
 
 void Map::Resize(int width, int height) {
 	assert(width > 0 && height > 0);
-	fields.resize(width * height);
 	this->width = width;
 	this->height = height;
+	rowWords = (width + 63) / 64;
+	bits.assign((size_t)height * 2 * rowWords, 0);
 }
 
 void Map::Generate(int numWalls, int numMines) {
 	std::uniform_int_distribution<int> rngx(0, width-1);
 	std::uniform_int_distribution<int> rngy(0, height-1);
 
-	for (auto& field : fields) {
-		field.type = Field::FREE;
-	}
+	std::fill(bits.begin(), bits.end(), 0);
 
 	int freeFields = width*height;
 
@@ -34,9 +34,8 @@ void Map::Generate(int numWalls, int numMines) {
 	while (numWalls > 0 && freeFields > 0) {
 		int x = rngx(rne);
 		int y = rngy(rne);
-		auto& field = (*this)(x, y);
-		if (field.type == Field::FREE) {
-			field.type = Field::WALL;
+		if (GetType(x, y) == Field::FREE) {
+			SetType(x, y, Field::WALL);
 			numWalls--;
 			freeFields--;
 		}
@@ -45,23 +44,60 @@ void Map::Generate(int numWalls, int numMines) {
 	while (numMines > 0 && freeFields > 0) {
 		int x = rngx(rne);
 		int y = rngy(rne);
-		auto& field = (*this)(x, y);
-		if (field.type == Field::FREE) {
-			field.type = Field::MINE;
+		if (GetType(x, y) == Field::FREE) {
+			SetType(x, y, Field::MINE);
 			numMines--;
 			freeFields--;
 		}
 	}
 }
 
-auto Map::operator()(int x, int y) -> Field& {
-	assert(x < width);
-	assert(y < height);
-	return fields[y*width + x];
+void Map::SetSeed(size_t seed) {
+	rne.seed((std::mt19937::result_type)seed);
 }
 
-auto Map::operator()(int x, int y) const -> const Field& {
+auto Map::operator()(int x, int y) -> FieldRef {
 	assert(x < width);
 	assert(y < height);
-	return fields[y*width + x];
-}
\ No newline at end of file
+	return FieldRef(*this, x, y);
+}
+
+auto Map::operator()(int x, int y) const -> Field {
+	return Field{ GetType(x, y) };
+}
+
+auto Map::GetType(int x, int y) const -> Field::eType {
+	assert(0 <= x && x < width);
+	assert(0 <= y && y < height);
+	const uint64_t* row = Row(y);
+	unsigned low = (row[x / 64] >> (x % 64)) & 1;
+	unsigned high = (row[rowWords + x / 64] >> (x % 64)) & 1;
+	return (Field::eType)(high << 1 | low);
+}
+
+void Map::SetType(int x, int y, Field::eType type) {
+	assert(0 <= x && x < width);
+	assert(0 <= y && y < height);
+	uint64_t* row = Row(y);
+	uint64_t bit = uint64_t(1) << (x % 64);
+	uint64_t& low = row[x / 64];
+	uint64_t& high = row[rowWords + x / 64];
+	low = (type & 1) ? (low | bit) : (low & ~bit);
+	high = (type & 2) ? (high | bit) : (high & ~bit);
+}
+
+void Map::GetRowMask(int y, Field::eType type, uint64_t* mask) const {
+	assert(0 <= y && y < height);
+	const uint64_t* low = Row(y);
+	const uint64_t* high = low + rowWords;
+	// a bit plane matches where it equals the corresponding bit of the type
+	const uint64_t lowFlip = (type & 1) ? 0 : ~uint64_t(0);
+	const uint64_t highFlip = (type & 2) ? 0 : ~uint64_t(0);
+	for (int i = 0; i < rowWords; ++i) {
+		mask[i] = (low[i] ^ lowFlip) & (high[i] ^ highFlip);
+	}
+	// free fields would match in the padding too
+	if (width % 64) {
+		mask[rowWords - 1] &= (uint64_t(1) << (width % 64)) - 1;
+	}
+}
@@ -2,11 +2,16 @@
 
 #include <vector>
 #include <random>
+#include <cstdint>
 
 ////////////////////////////////////////////////////////////////////////////////
 /// Map for the 'mines' problem.
 /// Contains the fields of the gaming environment. The fields are all one of the
 /// predefined ones. See Game for more.
+///
+/// The fields are packed into 2 bits each, stored as two bit planes per row:
+/// the low and the high bit of the field's type. Rows are padded to whole
+/// 64 bit words. Use GetRowMask to query a whole row of a type at once.
 ////////////////////////////////////////////////////////////////////////////////
 class Map {
 public:
@@ -20,7 +25,7 @@ public:
 
 		eType type = FREE;
 
-		float Reward() {
+		float Reward() const {
 			switch (type)
 			{
 				case Field::FREE:
@@ -36,6 +41,29 @@ public:
 			}
 		}
 	};
+
+	/// Reference to a field of the packed map.
+	/// Behaves like a Field&, so that map(x, y).type can be read and assigned.
+	class FieldRef {
+	public:
+		/// Reference to the type of a field.
+		class TypeRef {
+		public:
+			TypeRef(Map& map, int x, int y) : map(map), x(x), y(y) {}
+			operator Field::eType() const { return map.GetType(x, y); }
+			TypeRef& operator=(Field::eType type) { map.SetType(x, y, type); return *this; }
+			TypeRef& operator=(const TypeRef& rhs) { return *this = (Field::eType)rhs; }
+		private:
+			Map& map;
+			int x, y;
+		};
+
+		FieldRef(Map& map, int x, int y) : type(map, x, y) {}
+		operator Field() const { return Field{ type }; }
+		float Reward() const { return Field{ type }.Reward(); }
+
+		TypeRef type;
+	};
 public:
 	/// Create a map with given size.
 	/// \param width Width of the game environment.
@@ -44,6 +72,7 @@ public:
 	~Map();
 
 	/// Resize the game environment.
+	/// All fields become free.
 	/// \param width Width of the game environment.
 	/// \param height Height of the game environment.
 	void Resize(int width, int height);
@@ -51,18 +80,46 @@ public:
 	/// \param numWalls The approximate number of walls on the map.
 	/// \param numMines The approximate number of mines on the map.
 	void Generate(int numWalls, int numMines);
+	/// Reseed the random engine used by Generate.
+	/// Use it to create reproducible layouts.
+	void SetSeed(size_t seed);
 
 	/// Get field at coordinates.
-	Field& operator()(int x, int y);
+	FieldRef operator()(int x, int y);
 	/// Get field at coordinates.
-	const Field& operator()(int x, int y) const;
+	Field operator()(int x, int y) const;
+	/// Get the type of the field at coordinates.
+	Field::eType GetType(int x, int y) const;
+	/// Set the type of the field at coordinates.
+	void SetType(int x, int y, Field::eType type);
+
+	/// Get the number of 64 bit words of a row mask.
+	int GetRowWords() const { return rowWords; }
+	/// Get a bit mask of the fields of a type in a row.
+	/// Bit x%64 of word x/64 is set if field (x, y) is of the type. The bits
+	/// past the width of the map are zero.
+	/// \param y The row.
+	/// \param type The type of fields to look for.
+	/// \param mask [output] Array of GetRowWords() words.
+	void GetRowMask(int y, Field::eType type, uint64_t* mask) const;
+	/// Get the packed fields of a row: the low bit plane of GetRowWords()
+	/// words followed by the high bit plane. The bits past the width are zero.
+	const uint64_t* GetRowData(int y) const { return Row(y); }
+	/// Get the packed fields of a row, see above. Keep the padding bits zero.
+	uint64_t* GetRowData(int y) { return Row(y); }
 
 	/// Get the width of the map.
 	int GetWidth() const { return width; }
 	/// Get the height of the map.
 	int GetHeight() const { return height; }
 private:
-	std::vector<Field> fields;
+	/// The low bit plane of a row, the high plane follows it.
+	uint64_t* Row(int y) { return &bits[(size_t)y * 2 * rowWords]; }
+	/// The low bit plane of a row, the high plane follows it.
+	const uint64_t* Row(int y) const { return &bits[(size_t)y * 2 * rowWords]; }
+
+	std::vector<uint64_t> bits; ///< Two bit planes of each row, low then high.
 	int width, height;
+	int rowWords; ///< Number of words in a bit plane of a row.
 	std::mt19937 rne;
-};
\ No newline at end of file
+};
@@ -0,0 +1,277 @@
+#include "MapFile.h"
+#include "Map.h"
+
+#include <cstring>
+
+
+namespace {
+
+/// Header of a map, followed by its rows.
+struct MapFileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize; ///< sizeof(MapFileHeader), to catch ABI differences.
+	int32_t width;
+	int32_t height;
+	int32_t rowWords;
+	int32_t startX;
+	int32_t startY;
+	int32_t finishX;
+	int32_t finishY;
+	int32_t numWalls;
+	int32_t numMines;
+	uint32_t reserved;
+	uint64_t seed;
+};
+
+/// Header of a library, followed by the maps and the index.
+struct LibraryHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize; ///< sizeof(LibraryHeader), to catch ABI differences.
+	uint64_t count; ///< Number of maps.
+	uint64_t indexOffset; ///< Position of the index: offset and size of each map.
+};
+
+constexpr char mapMagic[8] = { 'M', 'I', 'H', 'F', 'M', 'A', 'P', ' ' };
+constexpr char libraryMagic[8] = { 'M', 'I', 'H', 'F', 'M', 'L', 'I', 'B' };
+constexpr uint32_t mapVersion = 1;
+constexpr uint32_t libraryVersion = 1;
+
+MapFileHeader MakeHeader(int width, int height, const MapInfo& info) {
+	MapFileHeader header = {};
+	std::memcpy(header.magic, mapMagic, sizeof(header.magic));
+	header.version = mapVersion;
+	header.headerSize = sizeof(MapFileHeader);
+	header.width = width;
+	header.height = height;
+	header.rowWords = (width + 63) / 64;
+	header.startX = info.startX;
+	header.startY = info.startY;
+	header.finishX = info.finishX;
+	header.finishY = info.finishY;
+	header.numWalls = info.numWalls;
+	header.numMines = info.numMines;
+	header.seed = info.seed;
+	return header;
+}
+
+bool ParseHeader(const MapFileHeader& header, MapInfo& info) {
+	if (std::memcmp(header.magic, mapMagic, sizeof(header.magic)) != 0
+		|| header.version != mapVersion
+		|| header.headerSize != sizeof(MapFileHeader)
+		|| header.width <= 0 || header.height <= 0
+		|| header.rowWords != (header.width + 63) / 64)
+	{
+		return false;
+	}
+	info.startX = header.startX;
+	info.startY = header.startY;
+	info.finishX = header.finishX;
+	info.finishY = header.finishY;
+	info.numWalls = header.numWalls;
+	info.numMines = header.numMines;
+	info.seed = header.seed;
+	return true;
+}
+
+/// Number of bytes of the rows of a map.
+uint64_t RowBytes(const MapFileHeader& header) {
+	return (uint64_t)header.height * 2 * header.rowWords * sizeof(uint64_t);
+}
+
+/// Clear the bits past the width in both planes of a row, in case the file
+/// was not written by Map.
+void ClearPadding(uint64_t* row, int width, int rowWords) {
+	if (width % 64) {
+		uint64_t mask = (uint64_t(1) << (width % 64)) - 1;
+		row[rowWords - 1] &= mask;
+		row[2 * rowWords - 1] &= mask;
+	}
+}
+
+}
+
+
+MapWriter::MapWriter(const std::string& path, int width, int height, const MapInfo& info) :
+	file(path, std::ios::binary | std::ios::trunc),
+	rowWords((width + 63) / 64),
+	height(height)
+{
+	MapFileHeader header = MakeHeader(width, height, info);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void MapWriter::WriteRow(const uint64_t* row) {
+	file.write(reinterpret_cast<const char*>(row), 2 * rowWords * sizeof(uint64_t));
+	++numRows;
+}
+
+void MapWriter::WriteMap(const Map& map) {
+	for (int y = 0; y < map.GetHeight(); ++y) {
+		WriteRow(map.GetRowData(y));
+	}
+}
+
+bool MapWriter::Close() {
+	file.close();
+	return !file.fail() && numRows == height;
+}
+
+
+MapReader::MapReader(const std::string& path) : file(path, std::ios::binary) {
+	MapFileHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+		return;
+	}
+	valid = ParseHeader(header, info);
+	width = header.width;
+	height = header.height;
+	rowWords = header.rowWords;
+}
+
+bool MapReader::ReadRow(uint64_t* row) {
+	if (!file.read(reinterpret_cast<char*>(row), 2 * rowWords * sizeof(uint64_t))) {
+		return false;
+	}
+	ClearPadding(row, width, rowWords);
+	return true;
+}
+
+bool MapReader::ReadMap(Map& map) {
+	if (!valid) {
+		return false;
+	}
+	map.Resize(width, height);
+	for (int y = 0; y < height; ++y) {
+		if (!ReadRow(map.GetRowData(y))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+bool SaveMap(const Map& map, const MapInfo& info, const std::string& path) {
+	MapWriter writer(path, map.GetWidth(), map.GetHeight(), info);
+	writer.WriteMap(map);
+	return writer.Close();
+}
+
+bool LoadMap(Map& map, const std::string& path, MapInfo* info) {
+	MapReader reader(path);
+	if (!reader.ReadMap(map)) {
+		return false;
+	}
+	if (info) {
+		*info = reader.GetInfo();
+	}
+	return true;
+}
+
+
+MapLibraryWriter::MapLibraryWriter(const std::string& path) :
+	file(path, std::ios::binary | std::ios::trunc)
+{
+	// the header is completed by Close
+	LibraryHeader header = {};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	position = sizeof(header);
+}
+
+void MapLibraryWriter::Add(const Map& map, const MapInfo& info) {
+	MapFileHeader header = MakeHeader(map.GetWidth(), map.GetHeight(), info);
+	uint64_t bytes = sizeof(header) + RowBytes(header);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(map.GetRowData(0)), RowBytes(header));
+	index.push_back({ position, bytes });
+	position += bytes;
+}
+
+bool MapLibraryWriter::Close() {
+	file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(Entry));
+
+	LibraryHeader header = {};
+	std::memcpy(header.magic, libraryMagic, sizeof(header.magic));
+	header.version = libraryVersion;
+	header.headerSize = sizeof(LibraryHeader);
+	header.count = index.size();
+	header.indexOffset = position;
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.close();
+	return !file.fail();
+}
+
+
+bool MapLibrary::Open(const std::string& path) {
+	index = nullptr;
+	count = 0;
+	if (!file.Open(path) || file.GetSize() < sizeof(LibraryHeader)) {
+		return false;
+	}
+	LibraryHeader header;
+	std::memcpy(&header, file.GetData(), sizeof(header));
+	if (std::memcmp(header.magic, libraryMagic, sizeof(header.magic)) != 0
+		|| header.version != libraryVersion
+		|| header.headerSize != sizeof(LibraryHeader)
+		|| header.indexOffset % sizeof(uint64_t) != 0
+		|| header.indexOffset > file.GetSize()
+		|| header.count > (file.GetSize() - header.indexOffset) / (2 * sizeof(uint64_t)))
+	{
+		file.Close();
+		return false;
+	}
+	index = reinterpret_cast<const uint64_t*>(file.GetData() + header.indexOffset);
+	count = header.count;
+	return true;
+}
+
+const char* MapLibrary::GetRecord(size_t i) const {
+	if (i >= count) {
+		return nullptr;
+	}
+	uint64_t offset = index[2 * i];
+	uint64_t bytes = index[2 * i + 1];
+	if (offset % sizeof(uint64_t) != 0 || bytes < sizeof(MapFileHeader) || offset > file.GetSize() || bytes > file.GetSize() - offset) {
+		return nullptr;
+	}
+	MapFileHeader header;
+	std::memcpy(&header, file.GetData() + offset, sizeof(header));
+	MapInfo info;
+	if (!ParseHeader(header, info) || bytes != sizeof(header) + RowBytes(header)) {
+		return nullptr;
+	}
+	return file.GetData() + offset;
+}
+
+bool MapLibrary::GetInfo(size_t i, int& width, int& height, MapInfo& info) const {
+	const char* record = GetRecord(i);
+	if (!record) {
+		return false;
+	}
+	MapFileHeader header;
+	std::memcpy(&header, record, sizeof(header));
+	ParseHeader(header, info);
+	width = header.width;
+	height = header.height;
+	return true;
+}
+
+bool MapLibrary::Load(size_t i, Map& map, MapInfo* info) const {
+	const char* record = GetRecord(i);
+	if (!record) {
+		return false;
+	}
+	MapFileHeader header;
+	std::memcpy(&header, record, sizeof(header));
+	if (info) {
+		ParseHeader(header, *info);
+	}
+	map.Resize(header.width, header.height);
+	std::memcpy(map.GetRowData(0), record + sizeof(header), RowBytes(header));
+	for (int y = 0; y < header.height; ++y) {
+		ClearPadding(map.GetRowData(y), header.width, header.rowWords);
+	}
+	return true;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+class Map;
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// Map files, and libraries of many maps in one file.
+///
+/// A map is stored as a header with its size and MapInfo, followed by the
+/// packed rows exactly as in Map: two bit planes of 64 bit words per row, see
+/// Map::GetRowData. That's 2 bits per field, plus the padding of the rows.
+/// Files are in the native byte order.
+///
+/// MapWriter and MapReader stream the rows one at a time, so a map can be
+/// written while it's generated, or read straight into a Map, without a second
+/// copy of it in memory.
+///
+/// A library is a header, the maps one after the other in the above format,
+/// and an index of the maps at the end. MapLibrary memory-maps it, so opening
+/// is instant and loading a map is a copy of its rows.
+////////////////////////////////////////////////////////////////////////////////
+
+/// Metadata of a stored map.
+struct MapInfo {
+	int startX = 0;
+	int startY = 0;
+	int finishX = 0;
+	int finishY = 0;
+	int numWalls = 0; ///< Number of walls requested from the generator.
+	int numMines = 0; ///< Number of mines requested from the generator.
+	uint64_t seed = 0; ///< Seed of the generator.
+};
+
+
+/// Writes a map file row by row.
+class MapWriter {
+public:
+	/// Create the file and write the header.
+	/// \param path The new map file.
+	/// \param width Width of the map.
+	/// \param height Height of the map.
+	/// \param info Metadata of the map.
+	MapWriter(const std::string& path, int width, int height, const MapInfo& info);
+
+	/// Write the next row.
+	/// \param row The packed row, 2*rowWords words as returned by Map::GetRowData.
+	void WriteRow(const uint64_t* row);
+	/// Write every row of the map.
+	void WriteMap(const Map& map);
+	/// Flush the file.
+	/// \return False if any of the writes failed or not every row has been written.
+	bool Close();
+private:
+	std::ofstream file;
+	int rowWords;
+	int height;
+	int numRows = 0;
+};
+
+
+/// Reads a map file row by row.
+class MapReader {
+public:
+	/// Open the file and read the header.
+	explicit MapReader(const std::string& path);
+
+	/// Wether the header is valid.
+	bool IsValid() const { return valid; }
+	int GetWidth() const { return width; }
+	int GetHeight() const { return height; }
+	const MapInfo& GetInfo() const { return info; }
+
+	/// Read the next row.
+	/// \param row [output] 2*rowWords words, as used by Map::GetRowData.
+	/// \return False if the file ended early.
+	bool ReadRow(uint64_t* row);
+	/// Resize the map, and read every row into it.
+	/// \return False if the file ended early.
+	bool ReadMap(Map& map);
+private:
+	std::ifstream file;
+	int width = 0;
+	int height = 0;
+	int rowWords = 0;
+	MapInfo info;
+	bool valid = false;
+};
+
+
+/// Write a map to a file.
+/// \return False if the file can't be written.
+bool SaveMap(const Map& map, const MapInfo& info, const std::string& path);
+/// Read a map from a file.
+/// \param info [output] Metadata of the map, optional.
+/// \return False if the file can't be read or is invalid.
+bool LoadMap(Map& map, const std::string& path, MapInfo* info = nullptr);
+
+
+/// Builds a library file from many maps.
+class MapLibraryWriter {
+public:
+	/// Create the file.
+	explicit MapLibraryWriter(const std::string& path);
+
+	/// Append a map.
+	void Add(const Map& map, const MapInfo& info);
+	/// Write the index and finish the file.
+	/// \return False if any of the writes failed.
+	bool Close();
+private:
+	/// Position of a map in the library.
+	struct Entry {
+		uint64_t offset;
+		uint64_t bytes;
+	};
+	std::ofstream file;
+	std::vector<Entry> index;
+	uint64_t position = 0;
+};
+
+
+/// A library file of maps, memory-mapped.
+class MapLibrary {
+public:
+	/// Map the file into memory.
+	/// \return False if the file can't be opened or is invalid.
+	bool Open(const std::string& path);
+
+	/// Get the number of maps in the library.
+	size_t GetCount() const { return count; }
+	/// Get the size and metadata of a map without loading it.
+	/// \return False if the index is out of range.
+	bool GetInfo(size_t index, int& width, int& height, MapInfo& info) const;
+	/// Resize the map, and copy a map of the library into it.
+	/// \return False if the index is out of range.
+	bool Load(size_t index, Map& map, MapInfo* info = nullptr) const;
+private:
+	/// Get the header of a map, or null if the index is out of range.
+	const char* GetRecord(size_t index) const;
+
+	MappedFile file;
+	const uint64_t* index = nullptr; ///< Offset and size of each map.
+	size_t count = 0;
+};
@@ -0,0 +1,416 @@
+#include "Util.h"
+#include "MapGenerator.h"
+#include "Philox.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+
+namespace {
+
+constexpr int deltaX[4] = { 0, 0, -1, 1 };
+constexpr int deltaY[4] = { 1, -1, 0, 0 };
+
+}
+
+
+MapGenerator::MapGenerator() : seed(Seed()), rne((std::mt19937::result_type)seed) {}
+
+
+void MapGenerator::SetSeed(size_t seed) {
+	this->seed = seed;
+	rne.seed((std::mt19937::result_type)seed);
+	numUniformLayouts = 0;
+}
+
+
+bool MapGenerator::Generate(Map& map, int numWalls, int numMines) {
+	stats = Stats();
+	const int finishX = map.GetWidth() - 1;
+	const int finishY = map.GetHeight() - 1;
+	while (true) {
+		GenerateLayout(map, numWalls, numMines);
+		map(0, 0).type = Map::Field::FREE;
+		map(finishX, finishY).type = Map::Field::FINISH;
+		++stats.numAttempts;
+
+		stats.solvable = IsSolvable(map);
+		if (stats.solvable || solvability == ANY) {
+			return stats.solvable;
+		}
+		if (solvability == REJECT && stats.numAttempts < maxAttempts) {
+			continue;
+		}
+		stats.numCleared = Repair(map);
+		stats.solvable = true;
+		return true;
+	}
+}
+
+
+bool MapGenerator::IsSolvable(const Map& map) {
+	const int width = map.GetWidth();
+	const int height = map.GetHeight();
+
+	// unvisited free fields from the row masks, with a closed border around
+	// the map, so that neighbours need no bounds checks
+	const int stride = width + 2;
+	const int rowWords = map.GetRowWords();
+	std::vector<uint8_t> open((size_t)stride * (height + 2), 0);
+	std::vector<uint64_t> free(rowWords), finishes(rowWords);
+	for (int y = 0; y < height; ++y) {
+		map.GetRowMask(y, Map::Field::FREE, free.data());
+		map.GetRowMask(y, Map::Field::FINISH, finishes.data());
+		uint8_t* row = &open[(size_t)(y + 1) * stride + 1];
+		for (int x = 0; x < width; ++x) {
+			row[x] = ((free[x / 64] | finishes[x / 64]) >> (x % 64)) & 1;
+		}
+	}
+	const int64_t start = stride + 1;
+	const int64_t finish = (int64_t)height * stride + width;
+	if (!open[start]) {
+		return false;
+	}
+
+	// the queue only holds the wavefront, which is usually small compared to
+	// the map, so it's a ring buffer that doubles when full
+	std::vector<int64_t> queue(1024);
+	size_t head = 0, tail = 0;
+	open[start] = 0;
+	queue[tail++] = start;
+	while (head != tail) {
+		int64_t cell = queue[head++ & (queue.size() - 1)];
+		if (cell == finish) {
+			return true;
+		}
+		if (queue.size() - (tail - head) < 4) {
+			std::vector<int64_t> grown(queue.size() * 2);
+			for (size_t i = head; i != tail; ++i) {
+				grown[i & (grown.size() - 1)] = queue[i & (queue.size() - 1)];
+			}
+			queue.swap(grown);
+		}
+		// branchless, whether a neighbour is open is hard to predict
+		const size_t mask = queue.size() - 1;
+		const int64_t neighbours[4] = { cell - 1, cell + 1, cell - stride, cell + stride };
+		for (int64_t next : neighbours) {
+			uint8_t isOpen = open[next];
+			open[next] = 0;
+			queue[tail & mask] = next;
+			tail += isOpen;
+		}
+	}
+	return false;
+}
+
+
+void MapGenerator::GenerateLayout(Map& map, int numWalls, int numMines) {
+	map.Resize(map.GetWidth(), map.GetHeight());
+	switch (layout) {
+		case MAZE:
+			GenerateMaze(map, numWalls, numMines);
+			break;
+		case CLUSTERED:
+			GenerateClustered(map, numWalls, numMines);
+			break;
+		case CORRIDOR:
+			GenerateCorridor(map, numWalls, numMines);
+			break;
+		case UNIFORM:
+			GenerateUniform(map, numWalls, numMines);
+			break;
+		default:
+			GenerateScatter(map, numWalls, numMines);
+			break;
+	}
+}
+
+
+void MapGenerator::GenerateScatter(Map& map, int numWalls, int numMines) {
+	// the walls and then the mines are the front of one shuffle of the fields
+	const int width = map.GetWidth();
+	CollectFree(map);
+	numWalls = std::min(std::max(0, numWalls), (int)cells.size());
+	numMines = std::min(std::max(0, numMines), (int)cells.size() - numWalls);
+	for (int i = 0; i < numWalls + numMines; ++i) {
+		int j = std::uniform_int_distribution<int>(i, (int)cells.size() - 1)(rne);
+		std::swap(cells[i], cells[j]);
+		map.SetType(cells[i] % width, cells[i] / width, i < numWalls ? Map::Field::WALL : Map::Field::MINE);
+	}
+}
+
+
+void MapGenerator::GenerateMaze(Map& map, int numWalls, int numMines) {
+	const int width = map.GetWidth();
+	const int height = map.GetHeight();
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			map.SetType(x, y, Map::Field::WALL);
+		}
+	}
+
+	// rooms are on even coordinates, depth first search through the walls between them
+	std::vector<int32_t>& stack = cells;
+	stack.clear();
+	map.SetType(0, 0, Map::Field::FREE);
+	stack.push_back(0);
+	while (!stack.empty()) {
+		int x = stack.back() % width;
+		int y = stack.back() / width;
+		int options[4];
+		int numOptions = 0;
+		for (int d = 0; d < 4; ++d) {
+			int nx = x + 2 * deltaX[d];
+			int ny = y + 2 * deltaY[d];
+			if (0 <= nx && nx < width && 0 <= ny && ny < height && map.GetType(nx, ny) == Map::Field::WALL) {
+				options[numOptions++] = d;
+			}
+		}
+		if (numOptions == 0) {
+			stack.pop_back();
+			continue;
+		}
+		int d = options[std::uniform_int_distribution<int>(0, numOptions - 1)(rne)];
+		map.SetType(x + deltaX[d], y + deltaY[d], Map::Field::FREE);
+		map.SetType(x + 2 * deltaX[d], y + 2 * deltaY[d], Map::Field::FREE);
+		stack.push_back((y + 2 * deltaY[d]) * width + x + 2 * deltaX[d]);
+	}
+
+	// knock out random walls to get down to the requested number
+	std::vector<int32_t>& walls = cells;
+	walls.clear();
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			if (map.GetType(x, y) == Map::Field::WALL) {
+				walls.push_back(y*width + x);
+			}
+		}
+	}
+	int numRemoved = std::max(0, (int)walls.size() - std::max(0, numWalls));
+	for (int i = 0; i < numRemoved; ++i) {
+		int j = std::uniform_int_distribution<int>(i, (int)walls.size() - 1)(rne);
+		std::swap(walls[i], walls[j]);
+		map.SetType(walls[i] % width, walls[i] / width, Map::Field::FREE);
+	}
+
+	Scatter(map, Map::Field::MINE, numMines);
+}
+
+
+void MapGenerator::GenerateClustered(Map& map, int numWalls, int numMines) {
+	Grow(map, Map::Field::WALL, numWalls);
+	Grow(map, Map::Field::MINE, numMines);
+}
+
+
+void MapGenerator::GenerateCorridor(Map& map, int numWalls, int numMines) {
+	const int width = map.GetWidth();
+	const int height = map.GetHeight();
+	// each line has a gap, and there is a free row before and after each line
+	int numLines = width > 1 ? std::min(numWalls / (width - 1), (height - 1) / 2) : 0;
+	for (int i = 0; i < numLines; ++i) {
+		int y = (i + 1) * height / (numLines + 1);
+		y = std::min(height - 2, std::max(1, y));
+		int gap = std::uniform_int_distribution<int>(0, width - 1)(rne);
+		for (int x = 0; x < width; ++x) {
+			if (x != gap) {
+				map.SetType(x, y, Map::Field::WALL);
+			}
+		}
+	}
+	Scatter(map, Map::Field::MINE, numMines);
+}
+
+
+void MapGenerator::GenerateUniform(Map& map, int numWalls, int numMines) {
+	const int width = map.GetWidth();
+	const int height = map.GetHeight();
+	const int rowWords = map.GetRowWords();
+	// a field is a wall below the first threshold, and a mine below the second
+	const double numFields = (double)width * height;
+	const double wallProbability = std::min(1.0, std::max(0.0, numWalls / numFields));
+	const double mineProbability = std::min(1.0 - wallProbability, std::max(0.0, numMines / numFields));
+	const uint64_t wallThreshold = (uint64_t)(wallProbability * 4294967296.0);
+	const uint64_t mineThreshold = (uint64_t)((wallProbability + mineProbability) * 4294967296.0);
+	const Philox philox(seed);
+	const uint32_t layoutIndex = numUniformLayouts++;
+
+	// a 64 field word of a row takes 16 blocks of 4 random numbers, the counter
+	// is (word index, layout index, block)
+	auto generateRows = [&](int firstRow, int lastRow) {
+		for (int y = firstRow; y < lastRow; ++y) {
+			uint64_t* low = map.GetRowData(y);
+			uint64_t* high = low + rowWords;
+			for (int w = 0; w < rowWords; ++w) {
+				uint64_t word = (uint64_t)y * rowWords + w;
+				uint64_t mines = 0, walls = 0;
+				for (uint32_t block = 0; block < 16; ++block) {
+					auto random = philox({ (uint32_t)word, (uint32_t)(word >> 32), layoutIndex, block });
+					for (int i = 0; i < 4; ++i) {
+						uint64_t bit = uint64_t(1) << (block * 4 + i);
+						walls |= random[i] < wallThreshold ? bit : 0;
+						mines |= (random[i] >= wallThreshold && random[i] < mineThreshold) ? bit : 0;
+					}
+				}
+				if (w == rowWords - 1 && width % 64) {
+					uint64_t padding = ~((uint64_t(1) << (width % 64)) - 1);
+					walls &= ~padding;
+					mines &= ~padding;
+				}
+				// MINE is the low bit of the type, WALL the high one
+				low[w] = mines;
+				high[w] = walls;
+			}
+		}
+	};
+
+	int threadCount = std::max(1, std::min(numThreads, height));
+	std::vector<std::thread> threads;
+	for (int t = 1; t < threadCount; ++t) {
+		threads.emplace_back(generateRows, (int)((int64_t)height * t / threadCount), (int)((int64_t)height * (t + 1) / threadCount));
+	}
+	generateRows(0, (int)((int64_t)height / threadCount));
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+
+void MapGenerator::CollectFree(const Map& map) {
+	const int width = map.GetWidth();
+	const int height = map.GetHeight();
+	const int rowWords = map.GetRowWords();
+	std::vector<uint64_t> mask(rowWords);
+	cells.clear();
+	for (int y = 0; y < height; ++y) {
+		map.GetRowMask(y, Map::Field::FREE, mask.data());
+		for (int w = 0; w < rowWords; ++w) {
+			uint64_t word = mask[w];
+			for (int x = w * 64; word != 0; ++x, word >>= 1) {
+				if ((word & 1) && !IsEndpoint(map, x, y)) {
+					cells.push_back(y*width + x);
+				}
+			}
+		}
+	}
+}
+
+
+int MapGenerator::Scatter(Map& map, Map::Field::eType type, int count) {
+	const int width = map.GetWidth();
+	CollectFree(map);
+	int numPlaced = std::min(std::max(0, count), (int)cells.size());
+	for (int i = 0; i < numPlaced; ++i) {
+		int j = std::uniform_int_distribution<int>(i, (int)cells.size() - 1)(rne);
+		std::swap(cells[i], cells[j]);
+		map.SetType(cells[i] % width, cells[i] / width, type);
+	}
+	return numPlaced;
+}
+
+
+void MapGenerator::Grow(Map& map, Map::Field::eType type, int count) {
+	const int width = map.GetWidth();
+	const int height = map.GetHeight();
+	CollectFree(map);
+
+	// the seeds are drawn from the free fields without replacement, so this
+	// ends even if the map fills up
+	std::vector<int32_t> frontier;
+	std::uniform_int_distribution<int> rngBlobSize(4, 32);
+	int numPlaced = 0;
+	for (size_t i = 0; i < cells.size() && numPlaced < count; ++i) {
+		size_t j = std::uniform_int_distribution<size_t>(i, cells.size() - 1)(rne);
+		std::swap(cells[i], cells[j]);
+		int blobSize = std::min(count - numPlaced, rngBlobSize(rne));
+		frontier.assign(1, cells[i]);
+		for (int numGrown = 0; numGrown < blobSize && !frontier.empty(); ) {
+			size_t k = std::uniform_int_distribution<size_t>(0, frontier.size() - 1)(rne);
+			int cell = frontier[k];
+			frontier[k] = frontier.back();
+			frontier.pop_back();
+			int x = cell % width;
+			int y = cell / width;
+			if (map.GetType(x, y) != Map::Field::FREE || IsEndpoint(map, x, y)) {
+				continue;
+			}
+			map.SetType(x, y, type);
+			++numGrown;
+			++numPlaced;
+			for (int d = 0; d < 4; ++d) {
+				int nx = x + deltaX[d];
+				int ny = y + deltaY[d];
+				if (0 <= nx && nx < width && 0 <= ny && ny < height) {
+					frontier.push_back(ny*width + nx);
+				}
+			}
+		}
+	}
+}
+
+
+int MapGenerator::Repair(Map& map) {
+	const int width = map.GetWidth();
+	const int height = map.GetHeight();
+	const int finish = (height - 1) * width + width - 1;
+	const int32_t unreached = std::numeric_limits<int32_t>::max();
+	costs.assign((size_t)width * height, unreached);
+	std::vector<int32_t>& previous = cells;
+	previous.assign((size_t)width * height, -1);
+
+	// entering a wall or a mine costs 1, as it has to be cleared
+	std::vector<uint8_t> blocked((size_t)width * height);
+	const int rowWords = map.GetRowWords();
+	std::vector<uint64_t> walls(rowWords), mines(rowWords);
+	for (int y = 0; y < height; ++y) {
+		map.GetRowMask(y, Map::Field::WALL, walls.data());
+		map.GetRowMask(y, Map::Field::MINE, mines.data());
+		for (int x = 0; x < width; ++x) {
+			blocked[y*width + x] = ((walls[x / 64] | mines[x / 64]) >> (x % 64)) & 1;
+		}
+	}
+
+	// 0-1 breadth first search, one queue per cost, free fields are appended
+	// to the current one, blocked ones to the next
+	std::vector<int32_t> current, next;
+	costs[0] = 0;
+	current.push_back(0);
+	for (int32_t cost = 0; !current.empty() && costs[finish] == unreached; ++cost) {
+		for (size_t head = 0; head < current.size(); ++head) {
+			int cell = current[head];
+			if (costs[cell] != cost) {
+				continue; // reached cheaper since queued
+			}
+			int x = cell % width;
+			int y = cell / width;
+			for (int d = 0; d < 4; ++d) {
+				int nx = x + deltaX[d];
+				int ny = y + deltaY[d];
+				if (nx < 0 || nx >= width || ny < 0 || ny >= height) {
+					continue;
+				}
+				int neighbour = ny*width + nx;
+				int32_t neighbourCost = cost + blocked[neighbour];
+				if (neighbourCost < costs[neighbour]) {
+					costs[neighbour] = neighbourCost;
+					previous[neighbour] = cell;
+					(blocked[neighbour] ? next : current).push_back(neighbour);
+				}
+			}
+		}
+		current.swap(next);
+		next.clear();
+	}
+
+	int numCleared = 0;
+	for (int cell = previous[finish]; cell > 0; cell = previous[cell]) {
+		int x = cell % width;
+		int y = cell / width;
+		if (map.GetType(x, y) != Map::Field::FREE) {
+			map.SetType(x, y, Map::Field::FREE);
+			++numCleared;
+		}
+	}
+	return numCleared;
+}
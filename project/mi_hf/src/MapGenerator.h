@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vector>
+#include <random>
+#include <cstdint>
+#include "Map.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// Generates maps in linear time with a choice of layouts, and makes sure the
+/// finish can be reached from the start.
+///
+/// The start is (0, 0), where the game starts, and the finish is the opposite
+/// corner. Both are kept free of walls and mines. The layouts:
+/// - SCATTER: walls and mines on uniformly random fields, like Map::Generate,
+///		but by a partial Fisher-Yates shuffle of the fields, so it takes the
+///		same time at any density.
+/// - MAZE: a perfect maze carved by a randomized depth first search, then
+///		random walls are knocked out until at most numWalls remain, which adds
+///		loops. Mines are scattered on the free fields.
+/// - CLUSTERED: walls and mines grow in blobs from random seeds.
+/// - CORRIDOR: full rows of walls, each with a single random gap, evenly
+///		spaced so that they add up to about numWalls. Mines are scattered.
+/// - UNIFORM: every field is a wall or a mine independently, with the
+///		probability that gives numWalls and numMines on average. The random
+///		numbers come from a counter-based generator (Philox) indexed by the
+///		field, so blocks of rows are generated in parallel, and the map only
+///		depends on the seed, not on the number of threads. The number of
+///		uniform layouts generated since seeding is part of the counter, so
+///		each Generate call, and each rejected attempt, gives a new layout.
+///
+/// A path from the start to the finish may only step on free fields. If there
+/// is none, the generator either retries with the next random layout, or
+/// repairs the map by clearing the fewest walls and mines that open a path,
+/// see eSolvability.
+////////////////////////////////////////////////////////////////////////////////
+class MapGenerator {
+public:
+	enum eLayout {
+		SCATTER,
+		MAZE,
+		CLUSTERED,
+		CORRIDOR,
+		UNIFORM,
+	};
+	enum eSolvability {
+		ANY, ///< Keep unsolvable maps.
+		REPAIR, ///< Clear a cheapest path.
+		REJECT, ///< Retry, and repair if the attempts run out.
+	};
+	/// Details of the last Generate call.
+	struct Stats {
+		int numAttempts = 0; ///< Layouts generated, more than 1 if rejected.
+		int numCleared = 0; ///< Fields cleared by the repair.
+		bool solvable = false; ///< Wether the finish is reachable in the final map.
+	};
+public:
+	MapGenerator();
+
+	/// Set the layout of the next maps.
+	void SetLayout(eLayout layout) { this->layout = layout; }
+	/// Set how unsolvable maps are handled.
+	/// \param solvability The policy.
+	/// \param maxAttempts Layouts to try before repairing, when rejecting.
+	void SetSolvability(eSolvability solvability, int maxAttempts = 16) {
+		this->solvability = solvability;
+		this->maxAttempts = maxAttempts;
+	}
+	/// Reseed the random engine, to create reproducible maps.
+	void SetSeed(size_t seed);
+	/// Set the number of threads of the UNIFORM layout.
+	void SetThreads(int numThreads) { this->numThreads = numThreads; }
+
+	/// Replace the fields of the map with a new layout of the same size.
+	/// \param numWalls The number of walls, exact for SCATTER and CLUSTERED.
+	/// \param numMines The number of mines, exact unless there is no room.
+	/// \return Wether the finish is reachable from the start.
+	bool Generate(Map& map, int numWalls, int numMines);
+	/// Get the details of the last Generate call.
+	const Stats& GetStats() const { return stats; }
+
+	/// Check if the finish is reachable from the start on free fields.
+	/// Breadth first search, linear in the size of the map.
+	static bool IsSolvable(const Map& map);
+private:
+	/// Generate the layout without caring for solvability.
+	void GenerateLayout(Map& map, int numWalls, int numMines);
+	void GenerateScatter(Map& map, int numWalls, int numMines);
+	void GenerateMaze(Map& map, int numWalls, int numMines);
+	void GenerateClustered(Map& map, int numWalls, int numMines);
+	void GenerateCorridor(Map& map, int numWalls, int numMines);
+	void GenerateUniform(Map& map, int numWalls, int numMines);
+	/// Fill cells with the indices of the free fields, except for the start
+	/// and the finish.
+	void CollectFree(const Map& map);
+	/// Turn randomly chosen free fields into the given type, except for the
+	/// start and the finish. Partial Fisher-Yates shuffle of the free fields.
+	/// \return The number of fields turned.
+	int Scatter(Map& map, Map::Field::eType type, int count);
+	/// Grow blobs of the given type on free fields from random seeds.
+	void Grow(Map& map, Map::Field::eType type, int count);
+	/// Clear the walls and mines on a path from the start to the finish that
+	/// crosses the fewest of them. 0-1 breadth first search.
+	/// \return The number of fields cleared.
+	int Repair(Map& map);
+	/// Wether a field is the start or the finish.
+	static bool IsEndpoint(const Map& map, int x, int y) {
+		return (x == 0 && y == 0) || (x == map.GetWidth() - 1 && y == map.GetHeight() - 1);
+	}
+
+	eLayout layout = SCATTER;
+	eSolvability solvability = REPAIR;
+	int maxAttempts = 16;
+	int numThreads = 1;
+	Stats stats;
+	uint64_t seed; ///< Key of the counter-based generator.
+	uint32_t numUniformLayouts = 0; ///< Uniform layouts generated since seeding.
+	std::mt19937 rne;
+	std::vector<int32_t> cells; ///< Scratch list of field indices.
+	std::vector<int32_t> costs; ///< Scratch distances of the repair.
+};
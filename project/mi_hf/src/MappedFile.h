@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// A whole file mapped into memory.
+/// The pages are read lazily on first access, so opening is instant
+/// regardless of the size of the file. The mapping is private: writes to the
+/// memory are copy-on-write, and never reach the file.
+////////////////////////////////////////////////////////////////////////////////
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/// Map a file, closing the previous one.
+	/// \return False if the file can't be opened or mapped.
+	bool Open(const std::string& path);
+	/// Unmap the file.
+	void Close();
+
+	/// Get the first byte of the file, null if none is open.
+	char* GetData() const { return data; }
+	/// Get the size of the file in bytes.
+	size_t GetSize() const { return size; }
+private:
+	char* data = nullptr;
+	size_t size = 0;
+};
+
+/// Rename a file, replacing the target if it exists, in a single step, so that
+/// the target is never missing: std::rename on POSIX, MoveFileEx on Windows.
+/// \return False if the file can't be renamed.
+bool RenameReplacing(const std::string& from, const std::string& to);
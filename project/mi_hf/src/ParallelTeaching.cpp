@@ -0,0 +1,209 @@
+#include "ParallelTeaching.h"
+#include "Agent.h"
+#include "Game.h"
+#include "Map.h"
+#include "Barrier.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <thread>
+
+
+ParallelTeachingResult TeachHogwild(Agent& agent, Map& map, int numThreads, int numEpisodes, size_t seed) {
+	auto model = std::make_shared<const TransitionModel>(map);
+	std::vector<Game> games(numThreads);
+	std::vector<Agent> workers(numThreads);
+
+	agent.Reset();
+	for (int i = 0; i < numThreads; ++i) {
+		games[i].SetMap(&map, model);
+		games[i].SetSeed(seed + 2 * i + 1);
+		workers[i].ShareTables(agent);
+		workers[i].SetGame(&games[i]);
+		workers[i].SetSeed(seed + 2 * i + 2);
+	}
+
+	ParallelTeachingResult result;
+	result.rewardHistory.resize(numEpisodes);
+	std::vector<long long> numSteps(numThreads, 0);
+	std::atomic<int> nextEpisode(0);
+
+	auto work = [&](int index) {
+		Game& game = games[index];
+		Agent& worker = workers[index];
+		long long steps = 0;
+		int episode;
+		while ((episode = nextEpisode.fetch_add(1, std::memory_order_relaxed)) < numEpisodes) {
+			game.NewGame();
+			worker.StartEpisode();
+			while (!game.Ended()) {
+				worker.Step();
+				++steps;
+			}
+			result.rewardHistory[episode] = worker.EndEpisode();
+		}
+		numSteps[index] = steps;
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (int i = 0; i < numThreads; ++i) {
+		threads.emplace_back(work, i);
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	auto end = std::chrono::steady_clock::now();
+	result.seconds = std::chrono::duration<double>(end - start).count();
+
+	for (auto steps : numSteps) {
+		result.numSteps += steps;
+	}
+	return result;
+}
+
+
+ParallelTeachingResult TeachModelAveraging(Agent& agent, Map& map, int numThreads, int numEpisodes, int mergeInterval, size_t seed) {
+	auto model = std::make_shared<const TransitionModel>(map);
+	std::vector<Game> games(numThreads);
+	std::vector<Agent> workers(numThreads);
+
+	agent.Reset();
+	for (int i = 0; i < numThreads; ++i) {
+		games[i].SetMap(&map, model);
+		games[i].SetSeed(seed + 2 * i + 1);
+		workers[i].CopySettings(agent);
+		workers[i].SetGame(&games[i]);
+		workers[i].SetSeed(seed + 2 * i + 2);
+	}
+
+	const int width = map.GetWidth();
+	const int height = map.GetHeight();
+	const int episodesPerRound = numThreads * mergeInterval;
+	const int numRounds = (numEpisodes + episodesPerRound - 1) / episodesPerRound;
+
+	// the merged tables as of the previous round
+	std::vector<float> mergedQ(width * height * 4, 0.0f);
+	std::vector<int> mergedN(width * height * 4, 0);
+
+	ParallelTeachingResult result;
+	result.rewardHistory.resize(numEpisodes);
+	std::vector<long long> numSteps(numThreads, 0);
+	std::vector<float> maxDeltas(numThreads, 0.0f);
+	Barrier barrier(numThreads);
+	auto start = std::chrono::steady_clock::now();
+
+	auto work = [&](int index) {
+		Game& game = games[index];
+		Agent& worker = workers[index];
+		long long steps = 0;
+
+		for (int round = 0; round < numRounds; ++round) {
+			// play this worker's share of the round
+			int first = round * episodesPerRound + index * mergeInterval;
+			int last = std::min(first + mergeInterval, numEpisodes);
+			for (int episode = first; episode < last; ++episode) {
+				game.NewGame();
+				worker.StartEpisode();
+				while (!game.Ended()) {
+					worker.Step();
+					++steps;
+				}
+				result.rewardHistory[episode] = worker.EndEpisode();
+			}
+			barrier.Wait();
+
+			// merge a slice of the rows from all workers into everyone
+			float maxDelta = 0.0f;
+			int firstRow = height * index / numThreads;
+			int lastRow = height * (index + 1) / numThreads;
+			for (int y = firstRow; y < lastRow; ++y) {
+				for (int x = 0; x < width; ++x) {
+					for (int a = 0; a < 4; ++a) {
+						size_t item = ((size_t)y*width + x) * 4 + a;
+						double weightedSum = 0;
+						long long visits = 0;
+						float q;
+						for (auto& other : workers) {
+							int newVisits = other.GetN(x, y, (eAction)a) - mergedN[item];
+							weightedSum += (double)newVisits * other.GetQ(x, y, (eAction)a);
+							visits += newVisits;
+						}
+						if (visits > 0) {
+							q = (float)(weightedSum / visits);
+						}
+						else {
+							// terminal fields are overwritten without visits, keep
+							// the mean of the workers that changed them
+							double changedSum = 0;
+							int numChanged = 0;
+							for (auto& other : workers) {
+								float otherQ = other.GetQ(x, y, (eAction)a);
+								if (otherQ != mergedQ[item]) {
+									changedSum += otherQ;
+									++numChanged;
+								}
+							}
+							q = numChanged > 0 ? (float)(changedSum / numChanged) : mergedQ[item];
+						}
+						maxDelta = std::max(maxDelta, std::abs(q - mergedQ[item]));
+						mergedQ[item] = q;
+						mergedN[item] += (int)visits;
+						for (auto& other : workers) {
+							// skip the unchanged entries, which keeps sparse tables sparse
+							if (other.GetQ(x, y, (eAction)a) != q || other.GetN(x, y, (eAction)a) != mergedN[item]) {
+								other.SetEntry(x, y, (eAction)a, q, mergedN[item]);
+							}
+						}
+					}
+				}
+			}
+			maxDeltas[index] = maxDelta;
+			barrier.Wait();
+
+			if (index == 0) {
+				int roundFirst = round * episodesPerRound;
+				int roundLast = std::min(roundFirst + episodesPerRound, numEpisodes);
+				double rewardSum = 0;
+				for (int episode = roundFirst; episode < roundLast; ++episode) {
+					rewardSum += result.rewardHistory[episode];
+				}
+				MergeRound stats;
+				stats.numEpisodes = roundLast;
+				stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				stats.maxDelta = *std::max_element(maxDeltas.begin(), maxDeltas.end());
+				stats.meanReward = (float)(rewardSum / (roundLast - roundFirst));
+				result.rounds.push_back(stats);
+			}
+		}
+		numSteps[index] = steps;
+	};
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < numThreads; ++i) {
+		threads.emplace_back(work, i);
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	auto end = std::chrono::steady_clock::now();
+	result.seconds = std::chrono::duration<double>(end - start).count();
+
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			for (int a = 0; a < 4; ++a) {
+				size_t item = ((size_t)y*width + x) * 4 + a;
+				if (mergedQ[item] != 0 || mergedN[item] != 0) {
+					agent.SetEntry(x, y, (eAction)a, mergedQ[item], mergedN[item]);
+				}
+			}
+		}
+	}
+	for (auto steps : numSteps) {
+		result.numSteps += steps;
+	}
+	return result;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include "Util.h"
+
+class Agent;
+class Map;
+
+////////////////////////////////////////////////////////////////////////////////
+/// Parallel teaching sessions of an agent.
+/// Every worker thread plays its own Game on the same map.
+////////////////////////////////////////////////////////////////////////////////
+
+/// Progress of the model averaging session after a merge.
+struct MergeRound {
+	int numEpisodes; ///< Total number of episodes played until the merge.
+	double seconds; ///< Wall time elapsed until the merge.
+	float maxDelta; ///< Largest change of a Q value caused by the round.
+	float meanReward; ///< Mean total reward of the episodes of the round.
+};
+
+/// Results of a parallel teaching session.
+struct ParallelTeachingResult {
+	std::vector<float> rewardHistory; ///< Total reward of each episode, in the order they were started.
+	long long numSteps = 0; ///< Number of steps taken by all workers together.
+	double seconds = 0; ///< Wall time of the session.
+	std::vector<MergeRound> rounds; ///< Progress after each merge, model averaging only.
+};
+
+/// Teaches the agent with many threads learning into its tables, Hogwild style.
+/// Each worker has its own Game and an Agent sharing the tables of the given
+/// agent, see Agent::ShareTables. The tables are reset first.
+/// The agent must already have a game on the map, see Agent::SetGame.
+/// \param agent The agent to teach.
+/// \param map The map of the games.
+/// \param numThreads The number of worker threads.
+/// \param numEpisodes The total number of episodes played by all workers.
+/// \param seed Seed of the workers' random engines.
+ParallelTeachingResult TeachHogwild(Agent& agent, Map& map, int numThreads, int numEpisodes, size_t seed);
+
+/// Teaches the agent with many threads learning into private tables, which
+/// are periodically merged.
+/// Each worker has its own Game and Agent. Every worker plays the given number
+/// of episodes, then the workers meet at a barrier and average their tables.
+/// Q values are weighted by the number of times the workers took the action
+/// in the round, and visit counts are summed. The merged tables are copied
+/// back to every worker, and finally to the given agent. The tables are reset
+/// first. The workers take the planning, layout and storage settings of the
+/// given agent.
+/// The agent must already have a game on the map, see Agent::SetGame.
+/// \param agent The agent to teach.
+/// \param map The map of the games.
+/// \param numThreads The number of worker threads.
+/// \param numEpisodes The total number of episodes played by all workers.
+/// \param mergeInterval The number of episodes a worker plays between merges.
+/// \param seed Seed of the workers' random engines.
+ParallelTeachingResult TeachModelAveraging(Agent& agent, Map& map, int numThreads, int numEpisodes, int mergeInterval, size_t seed);
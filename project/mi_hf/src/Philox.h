@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// Philox4x32-10 counter-based random number generator.
+/// A keyed bijection of 128 bit counters: each counter maps to 4 random 32 bit
+/// words, independently of any other counter. Any part of a random sequence
+/// can therefore be computed directly, in any order, from any thread.
+/// See Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", 2011.
+////////////////////////////////////////////////////////////////////////////////
+class Philox {
+public:
+	using Counter = std::array<uint32_t, 4>;
+
+	/// \param seed The key of the generator.
+	explicit Philox(uint64_t seed) : key{ (uint32_t)seed, (uint32_t)(seed >> 32) } {}
+
+	/// Get the 4 random words of a counter.
+	Counter operator()(Counter counter) const {
+		uint32_t k0 = key[0];
+		uint32_t k1 = key[1];
+		for (int round = 0; round < 10; ++round) {
+			uint64_t product0 = (uint64_t)multiplier0 * counter[0];
+			uint64_t product1 = (uint64_t)multiplier1 * counter[2];
+			counter = {
+				(uint32_t)(product1 >> 32) ^ counter[1] ^ k0,
+				(uint32_t)product1,
+				(uint32_t)(product0 >> 32) ^ counter[3] ^ k1,
+				(uint32_t)product0,
+			};
+			k0 += weyl0;
+			k1 += weyl1;
+		}
+		return counter;
+	}
+private:
+	static constexpr uint32_t multiplier0 = 0xD2511F53;
+	static constexpr uint32_t multiplier1 = 0xCD9E8D57;
+	static constexpr uint32_t weyl0 = 0x9E3779B9;
+	static constexpr uint32_t weyl1 = 0xBB67AE85;
+
+	uint32_t key[2];
+};
@@ -0,0 +1,123 @@
+#include "Random.h"
+
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <ostream>
+
+
+RandomSource::RandomSource(eEngine engine, uint64_t seed) : engine(engine) {
+	SetSeed(seed);
+}
+
+
+void RandomSource::SetEngine(eEngine engine) {
+	this->engine = engine;
+	SetSeed(seed);
+}
+
+
+void RandomSource::SetSeed(uint64_t seed) {
+	this->seed = seed;
+	switch (engine) {
+		case XOSHIRO256:
+			xoshiro.Seed(seed);
+			break;
+		case PCG32:
+			pcg.Seed(seed);
+			break;
+		default:
+			mt.seed((std::mt19937::result_type)seed);
+			break;
+	}
+	position = blockSize;
+}
+
+
+void RandomSource::Refill() {
+	switch (engine) {
+		case XOSHIRO256:
+			xoshiro.Fill(buffer, blockSize);
+			break;
+		case PCG32:
+			for (float& value : buffer) {
+				value = (float)(pcg() >> 8) * (1.0f / 16777216.0f);
+			}
+			break;
+		default:
+			for (float& value : buffer) {
+				value = std::generate_canonical<float, std::numeric_limits<float>::digits>(mt);
+			}
+			break;
+	}
+	position = 0;
+}
+
+
+std::ostream& operator<<(std::ostream& os, const RandomSource& source) {
+	os << (int)source.engine << ' ' << source.seed << ' ';
+	switch (source.engine) {
+		case RandomSource::XOSHIRO256:
+			for (auto& word : source.xoshiro.s) {
+				for (auto lane : word) {
+					os << lane << ' ';
+				}
+			}
+			break;
+		case RandomSource::PCG32:
+			os << source.pcg.state << ' ' << source.pcg.increment << ' ';
+			break;
+		default:
+			os << source.mt << ' ';
+			break;
+	}
+	// the buffered numbers as their bits, to read them back exactly
+	os << source.position;
+	for (size_t i = source.position; i < RandomSource::blockSize; ++i) {
+		uint32_t bits;
+		std::memcpy(&bits, &source.buffer[i], sizeof(bits));
+		os << ' ' << bits;
+	}
+	return os;
+}
+
+
+std::istream& operator>>(std::istream& is, RandomSource& source) {
+	int engine;
+	RandomSource loaded(RandomSource::MT19937, 0);
+	is >> engine >> loaded.seed;
+	if (engine < RandomSource::MT19937 || engine > RandomSource::PCG32) {
+		is.setstate(std::ios::failbit);
+		return is;
+	}
+	loaded.engine = (RandomSource::eEngine)engine;
+	switch (loaded.engine) {
+		case RandomSource::XOSHIRO256:
+			for (auto& word : loaded.xoshiro.s) {
+				for (auto& lane : word) {
+					is >> lane;
+				}
+			}
+			break;
+		case RandomSource::PCG32:
+			is >> loaded.pcg.state >> loaded.pcg.increment;
+			break;
+		default:
+			is >> loaded.mt;
+			break;
+	}
+	is >> loaded.position;
+	if (!is || loaded.position > RandomSource::blockSize) {
+		is.setstate(std::ios::failbit);
+		return is;
+	}
+	for (size_t i = loaded.position; i < RandomSource::blockSize; ++i) {
+		uint32_t bits;
+		is >> bits;
+		std::memcpy(&loaded.buffer[i], &bits, sizeof(bits));
+	}
+	if (is) {
+		source = loaded;
+	}
+	return is;
+}
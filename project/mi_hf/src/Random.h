@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <random>
+#include "Util.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// Fast random engines, and a source of uniform random floats that refills a
+/// buffer in blocks from a selectable engine.
+////////////////////////////////////////////////////////////////////////////////
+
+/// Four independent xoshiro256+ generators side by side.
+/// The state is stored word-major, so that stepping all four lanes is plain
+/// element-wise arithmetic that the compiler turns into SIMD instructions.
+/// xoshiro256+ is the variant meant for floating point numbers: its upper
+/// bits are of full quality, and it needs no multiplication.
+class Xoshiro256Plus4 {
+public:
+	static constexpr int numLanes = 4;
+
+	/// Initialize the lanes from a seed by SplitMix64.
+	void Seed(uint64_t seed) {
+		for (auto& word : s) {
+			for (auto& lane : word) {
+				lane = SplitMix64(seed);
+			}
+		}
+	}
+
+	/// Fill an array with uniform floats in [0, 1).
+	/// \param count Multiple of numLanes.
+	void Fill(float* out, size_t count) {
+		for (size_t i = 0; i < count; i += numLanes) {
+			for (int l = 0; l < numLanes; ++l) {
+				uint64_t result = s[0][l] + s[3][l];
+				uint64_t t = s[1][l] << 17;
+				s[2][l] ^= s[0][l];
+				s[3][l] ^= s[1][l];
+				s[1][l] ^= s[2][l];
+				s[0][l] ^= s[3][l];
+				s[2][l] ^= t;
+				s[3][l] = (s[3][l] << 45) | (s[3][l] >> 19);
+				// the top 24 bits fill the mantissa exactly
+				out[i + l] = (float)(uint32_t)(result >> 40) * (1.0f / 16777216.0f);
+			}
+		}
+	}
+
+	uint64_t s[4][numLanes];
+};
+
+
+/// PCG32: a 64 bit linear congruential generator with a permuted 32 bit
+/// output (XSH-RR). Small state, good quality, one multiplication per number.
+class Pcg32 {
+public:
+	using result_type = uint32_t;
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return ~result_type(0); }
+
+	/// \param seed Initial state.
+	/// \param stream Selects one of 2^63 independent sequences.
+	void Seed(uint64_t seed, uint64_t stream = 0) {
+		state = 0;
+		increment = (stream << 1) | 1;
+		(*this)();
+		state += seed;
+		(*this)();
+	}
+
+	result_type operator()() {
+		uint64_t old = state;
+		state = old * 6364136223846793005ull + increment;
+		uint32_t xorShifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+		uint32_t rotation = (uint32_t)(old >> 59);
+		return (xorShifted >> rotation) | (xorShifted << ((32 - rotation) & 31));
+	}
+
+	uint64_t state = 0;
+	uint64_t increment = 1;
+};
+
+
+/// Uniform random floats in [0, 1) from a buffer, refilled a block at a time.
+/// Refilling in blocks keeps the engine's state in registers, and lets the
+/// xoshiro engine generate four numbers per instruction.
+/// With MT19937, the numbers are the same as those of
+/// std::uniform_real_distribution<float>(0, 1) on a std::mt19937.
+class RandomSource {
+public:
+	enum eEngine {
+		MT19937,
+		XOSHIRO256,
+		PCG32,
+	};
+	static constexpr size_t blockSize = 256;
+public:
+	/// \param engine The engine that fills the buffer.
+	/// \param seed The seed of the engine.
+	explicit RandomSource(eEngine engine = MT19937, uint64_t seed = Seed());
+
+	/// Get the next uniform float in [0, 1).
+	float Uniform() {
+		if (position == blockSize) {
+			Refill();
+		}
+		return buffer[position++];
+	}
+
+	/// Change the engine, and reseed it with the latest seed.
+	void SetEngine(eEngine engine);
+	/// Get the current engine.
+	eEngine GetEngine() const { return engine; }
+	/// Reseed the engine, and drop the buffered numbers.
+	void SetSeed(uint64_t seed);
+
+	/// Write the exact state, including the buffered numbers, as text.
+	friend std::ostream& operator<<(std::ostream& os, const RandomSource& source);
+	/// Read the state written by operator<<.
+	friend std::istream& operator>>(std::istream& is, RandomSource& source);
+private:
+	void Refill();
+
+	eEngine engine;
+	uint64_t seed;
+	std::mt19937 mt;
+	Xoshiro256Plus4 xoshiro;
+	Pcg32 pcg;
+	alignas(32) float buffer[blockSize];
+	size_t position = blockSize; ///< Index of the next number, blockSize if empty.
+};
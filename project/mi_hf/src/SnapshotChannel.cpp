@@ -0,0 +1,65 @@
+#include "SnapshotChannel.h"
+#include "Visualization.h"
+
+#include <algorithm>
+#include <thread>
+
+
+void SnapshotChannel::Reset(int width, int height) {
+	this->width = width;
+	this->height = height;
+	for (auto& buffer : buffers) {
+		buffer.values.assign((size_t)width * height, 0.0f);
+		buffer.min = 0;
+		buffer.max = 1;
+		buffer.version = 0;
+	}
+	numPublished = 0;
+	front.store(0);
+	reading.store(-1);
+	requested.store(false);
+}
+
+
+auto SnapshotChannel::Acquire() -> const Buffer& {
+	// the writer may swap between the load and the pin, then try again
+	int index = front.load();
+	reading.store(index);
+	while (front.load() != index) {
+		index = front.load();
+		reading.store(index);
+	}
+	return buffers[index];
+}
+
+
+bool SnapshotChannel::Poll(const Agent& agent, bool qMax) {
+	if (!requested.load(std::memory_order_relaxed)) {
+		return false;
+	}
+	int back = 1 - front.load(std::memory_order_relaxed);
+	if (reading.load() == back) {
+		return false;
+	}
+	requested.store(false, std::memory_order_relaxed);
+	Write(back, agent, qMax);
+	return true;
+}
+
+
+void SnapshotChannel::Publish(const Agent& agent, bool qMax) {
+	int back = 1 - front.load(std::memory_order_relaxed);
+	while (reading.load() == back) {
+		std::this_thread::yield();
+	}
+	requested.store(false, std::memory_order_relaxed);
+	Write(back, agent, qMax);
+}
+
+
+void SnapshotChannel::Write(int back, const Agent& agent, bool qMax) {
+	Buffer& buffer = buffers[back];
+	ComputeStateValues(agent, width, height, qMax, buffer.values.data(), buffer.min, buffer.max);
+	buffer.version = ++numPublished;
+	front.store(back);
+}
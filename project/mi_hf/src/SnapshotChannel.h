@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+class Agent;
+
+////////////////////////////////////////////////////////////////////////////////
+/// Hands the state values of an agent from the teaching thread to the
+/// display, see ComputeStateValues.
+/// The display requests a snapshot at most once per frame, and the teaching
+/// thread polls for requests, so it only scans the tables when somebody is
+/// looking. Snapshots are written into the back one of two buffers, which is
+/// then published by swapping the index of the front buffer. The display pins
+/// the front buffer while it reads it, and the teaching thread never writes a
+/// pinned buffer, so the display never sees a torn table.
+/// There is a single writer and a single reader thread.
+////////////////////////////////////////////////////////////////////////////////
+class SnapshotChannel {
+public:
+	/// The values of the states of a snapshot.
+	struct Buffer {
+		std::vector<float> values; ///< Row-major.
+		float min = 0; ///< The lowest value, but at most 0.
+		float max = 1; ///< The highest value, but at least 1.
+		uint64_t version = 0; ///< Number of snapshots published before this one, plus one.
+	};
+public:
+	SnapshotChannel() = default;
+	SnapshotChannel(const SnapshotChannel&) = delete;
+	SnapshotChannel& operator=(const SnapshotChannel&) = delete;
+
+	/// Set the size of the map, and clear both buffers to zero.
+	/// Call while neither the reader nor the writer use the channel.
+	void Reset(int width, int height);
+
+	/// Reader: ask for a new snapshot. Call at most once per frame.
+	void Request() { requested.store(true, std::memory_order_relaxed); }
+	/// Reader: pin the latest published snapshot, until Release.
+	const Buffer& Acquire();
+	/// Reader: unpin the snapshot of Acquire.
+	void Release() { reading.store(-1); }
+
+	/// Writer: publish a snapshot of the agent if one was requested.
+	/// Costs an atomic load if not. If the reader still holds the back
+	/// buffer, the request is kept for the next poll.
+	/// \param qMax See ComputeStateValues.
+	/// \return True if a snapshot was published.
+	bool Poll(const Agent& agent, bool qMax);
+	/// Writer: publish a snapshot of the agent, requested or not. Waits for
+	/// the reader to release the back buffer, if needed.
+	void Publish(const Agent& agent, bool qMax);
+private:
+	/// Fill the back buffer and swap it to the front.
+	void Write(int back, const Agent& agent, bool qMax);
+
+	Buffer buffers[2];
+	int width = 0;
+	int height = 0;
+	uint64_t numPublished = 0; ///< Written by the writer only.
+	std::atomic<int> front{ 0 }; ///< Index of the published buffer.
+	std::atomic<int> reading{ -1 }; ///< Index of the buffer pinned by the reader, -1 for none.
+	std::atomic<bool> requested{ false };
+};
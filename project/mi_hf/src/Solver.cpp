@@ -0,0 +1,232 @@
+#include "Solver.h"
+#include "Map.h"
+#include "TransitionModel.h"
+#include "Barrier.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+
+namespace {
+
+constexpr float pIntended = 1.0f - 2 * TransitionModel::slipProbability;
+constexpr float pSlip = TransitionModel::slipProbability;
+
+/// Per-field constants of the sweeps, as separate contiguous arrays.
+struct SweepData {
+	int width;
+	std::vector<float> reward; ///< Reward of stepping on the field.
+	std::vector<float> discount; ///< gamma, or zero for terminal fields.
+	std::vector<float> open[4]; ///< One if the neighbour in the direction can be entered, zero otherwise.
+};
+
+/// Computes Q of the four actions of the fields [first, last) from the values of
+/// stepping on each field. Bumping into something is the same as stepping on
+/// the field itself.
+/// g must be readable from index first - width - 1 to last + width.
+template <class Func>
+inline void ForEachQ(const SweepData& data, const float* g, int first, int last, Func&& func) {
+	const int width = data.width;
+	const float* openUp = data.open[UP].data();
+	const float* openDown = data.open[DOWN].data();
+	const float* openLeft = data.open[LEFT].data();
+	const float* openRight = data.open[RIGHT].data();
+	for (int c = first; c < last; ++c) {
+		float self = g[c];
+		float up = self + openUp[c] * (g[c + width] - self);
+		float down = self + openDown[c] * (g[c - width] - self);
+		float left = self + openLeft[c] * (g[c - 1] - self);
+		float right = self + openRight[c] * (g[c + 1] - self);
+		float qUp = pIntended*up + pSlip*(left + right);
+		float qDown = pIntended*down + pSlip*(left + right);
+		float qLeft = pIntended*left + pSlip*(up + down);
+		float qRight = pIntended*right + pSlip*(up + down);
+		func(c, qUp, qDown, qLeft, qRight);
+	}
+}
+
+/// Fill the per-field constants of the sweeps from a model.
+void BuildSweepData(const TransitionModel& model, float gamma, SweepData& data) {
+	const int numCells = model.GetNumCells();
+	data.width = model.GetWidth();
+	data.reward.resize(numCells);
+	data.discount.resize(numCells);
+	for (auto& open : data.open) {
+		open.resize(numCells);
+	}
+	for (int c = 0; c < numCells; ++c) {
+		data.reward[c] = model.Reward(c);
+		data.discount[c] = model.Terminal(c) ? 0.0f : gamma;
+		for (int a = 0; a < 4; ++a) {
+			data.open[a][c] = model(c, (eAction)a).next[TransitionModel::INTENDED] != c ? 1.0f : 0.0f;
+		}
+	}
+}
+
+/// One Jacobi sweep over the fields [first, last).
+/// \return The largest change of a value.
+float Sweep(const SweepData& data, const float* src, float* dst, int first, int last) {
+	const float* reward = data.reward.data();
+	const float* discount = data.discount.data();
+	float residual = 0.0f;
+	ForEachQ(data, src, first, last, [&](int c, float qUp, float qDown, float qLeft, float qRight) {
+		float value = std::max(std::max(qUp, qDown), std::max(qLeft, qRight));
+		float g = reward[c] + discount[c] * value;
+		residual = std::max(residual, std::abs(g - src[c]));
+		dst[c] = g;
+	});
+	return residual;
+}
+
+}
+
+
+Solver::Solver(float gamma) : gamma(gamma) {}
+
+
+auto Solver::Solve(const Map& map, float tolerance, int numThreads, int maxSweeps) -> Stats {
+	return Solve(TransitionModel(map), tolerance, numThreads, maxSweeps);
+}
+
+
+auto Solver::Solve(const TransitionModel& model, float tolerance, int numThreads, int maxSweeps) -> Stats {
+	assert(numThreads > 0);
+	width = model.GetWidth();
+	height = model.GetHeight();
+	const int numCells = width * height;
+	numThreads = std::max(1, std::min(numThreads, height));
+
+	SweepData data;
+	BuildSweepData(model, gamma, data);
+
+	// values of stepping on a field, padded by a row and a field on both ends
+	const int padding = width + 1;
+	std::vector<float> buffers[2] = {
+		std::vector<float>(numCells + 2 * padding, 0.0f),
+		std::vector<float>(numCells + 2 * padding, 0.0f),
+	};
+	for (int c = 0; c < numCells; ++c) {
+		buffers[0][padding + c] = data.reward[c];
+	}
+	float* g[2] = { buffers[0].data() + padding, buffers[1].data() + padding };
+
+	Q_.resize(numCells);
+	Stats stats;
+	std::vector<float> residuals[2] = { std::vector<float>(numThreads), std::vector<float>(numThreads) };
+	Barrier barrier(numThreads);
+
+	auto work = [&](int index) {
+		int first = height * index / numThreads * width;
+		int last = height * (index + 1) / numThreads * width;
+		int sweep = 0;
+		float residual = 0.0f;
+		while (sweep < maxSweeps) {
+			int parity = sweep % 2;
+			residuals[parity][index] = Sweep(data, g[parity], g[1 - parity], first, last);
+			++sweep;
+			barrier.Wait();
+			residual = *std::max_element(residuals[parity].begin(), residuals[parity].end());
+			if (residual < tolerance) {
+				break;
+			}
+		}
+
+		const float* values = g[sweep % 2];
+		ForEachQ(data, values, first, last, [&](int c, float qUp, float qDown, float qLeft, float qRight) {
+			if (data.discount[c] == 0.0f) {
+				Q_[c] = { data.reward[c], data.reward[c], data.reward[c], data.reward[c] };
+			}
+			else {
+				Q_[c] = { qUp, qDown, qLeft, qRight };
+			}
+		});
+
+		if (index == 0) {
+			stats.numSweeps = sweep;
+			stats.residual = residual;
+			stats.converged = residual < tolerance;
+		}
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (int i = 1; i < numThreads; ++i) {
+		threads.emplace_back(work, i);
+	}
+	work(0);
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	auto end = std::chrono::steady_clock::now();
+	stats.seconds = std::chrono::duration<double>(end - start).count();
+
+	return stats;
+}
+
+
+float Solver::Evaluate(const TransitionModel& model, const eAction* policy, float tolerance, int maxSweeps) const {
+	const int numCells = model.GetNumCells();
+	SweepData data;
+	BuildSweepData(model, gamma, data);
+
+	// values of stepping on a field under the policy, padded as in Solve
+	const int padding = model.GetWidth() + 1;
+	std::vector<float> buffers[2] = {
+		std::vector<float>(numCells + 2 * padding, 0.0f),
+		std::vector<float>(numCells + 2 * padding, 0.0f),
+	};
+	for (int c = 0; c < numCells; ++c) {
+		buffers[0][padding + c] = data.reward[c];
+	}
+	float* g[2] = { buffers[0].data() + padding, buffers[1].data() + padding };
+
+	auto policyQ = [policy](int c, float qUp, float qDown, float qLeft, float qRight) {
+		if (!policy) {
+			return 0.25f * (qUp + qDown + qLeft + qRight);
+		}
+		switch (policy[c]) {
+			case UP: return qUp;
+			case DOWN: return qDown;
+			case LEFT: return qLeft;
+			default: return qRight;
+		}
+	};
+
+	int sweep = 0;
+	while (sweep < maxSweeps) {
+		const float* src = g[sweep % 2];
+		float* dst = g[1 - sweep % 2];
+		float residual = 0.0f;
+		ForEachQ(data, src, 0, numCells, [&](int c, float qUp, float qDown, float qLeft, float qRight) {
+			float value = data.reward[c] + data.discount[c] * policyQ(c, qUp, qDown, qLeft, qRight);
+			residual = std::max(residual, std::abs(value - src[c]));
+			dst[c] = value;
+		});
+		++sweep;
+		if (residual < tolerance) {
+			break;
+		}
+	}
+
+	// the start field's own reward isn't collected
+	float start = 0.0f;
+	ForEachQ(data, g[sweep % 2], 0, 1, [&](int c, float qUp, float qDown, float qLeft, float qRight) {
+		start = policyQ(c, qUp, qDown, qLeft, qRight);
+	});
+	return start;
+}
+
+
+float Solver::GetQ(int x, int y, eAction action) const {
+	assert(0 <= x && x < width && 0 <= y && y < height);
+	return Q_[y*width + x][action];
+}
+
+
+float Solver::GetQMax(int x, int y) const {
+	assert(0 <= x && x < width && 0 <= y && y < height);
+	return *std::max_element(Q_[y*width + x].begin(), Q_[y*width + x].end());
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include "Util.h"
+
+class Map;
+class TransitionModel;
+
+////////////////////////////////////////////////////////////////////////////////
+/// Computes the optimal Q*(state, action) table of a map by value iteration.
+/// The rules of the game are fully known (see TransitionModel), so there is no
+/// need for sampling. Uses the same conventions as Agent: the reward comes from
+/// the field the agent steps on, the game has no future after a mine or the
+/// finish, and the Q values of those fields are their rewards.
+///
+/// The sweeps iterate the value of stepping on each field,
+///		G(f) = reward(f) + gamma * max_a Q(f, a), or just reward(f) if terminal,
+/// where Q(f, a) is the slip-weighted sum of G over the three destinations.
+/// A sweep goes over the map row by row with contiguous loads only, so the
+/// compiler vectorizes it. Rows are split among threads, which meet after
+/// each sweep.
+////////////////////////////////////////////////////////////////////////////////
+class Solver {
+public:
+	/// Statistics of a solution.
+	struct Stats {
+		int numSweeps = 0; ///< Number of sweeps until convergence.
+		double seconds = 0; ///< Wall time of the sweeps.
+		float residual = 0; ///< Largest change of a value in the last sweep.
+		bool converged = false; ///< Wether the residual got below the tolerance.
+	};
+public:
+	/// \param gamma Discount constant, the same as Agent's by default.
+	Solver(float gamma = 0.98f);
+	~Solver() = default;
+
+	/// Compute Q* for a map.
+	/// \param map The map to solve.
+	/// \param tolerance Stop when no value changes more than this in a sweep.
+	/// \param numThreads The number of threads that share the sweeps.
+	/// \param maxSweeps Stop after this many sweeps even if not converged.
+	Stats Solve(const Map& map, float tolerance = 1e-6f, int numThreads = 1, int maxSweeps = 100000);
+	/// Compute Q* for an already compiled map.
+	Stats Solve(const TransitionModel& model, float tolerance = 1e-6f, int numThreads = 1, int maxSweeps = 100000);
+
+	/// Compute the expected discounted return of a policy from the start
+	/// field, by iterating the values of the fields under the policy. Same
+	/// conventions as Solve, so following the optimal policy gives
+	/// GetQMax(0, 0). Doesn't modify the solution.
+	/// \param model The compiled map.
+	/// \param policy The action to take on each field, row-major. Null for the
+	///		uniform random policy.
+	/// \param tolerance Stop when no value changes more than this in a sweep.
+	/// \param maxSweeps Stop after this many sweeps even if not converged.
+	float Evaluate(const TransitionModel& model, const eAction* policy, float tolerance = 1e-6f, int maxSweeps = 100000) const;
+
+	/// Get an item of the optimal Q table.
+	/// \param x The x coordinate of the requested state.
+	/// \param y The y coordinate of the requested state.
+	/// \param action The action.
+	float GetQ(int x, int y, eAction action) const;
+	/// Get the optimal value of a state, the max of Q* over the actions.
+	float GetQMax(int x, int y) const;
+
+	/// Get the width of the solved map.
+	int GetWidth() const { return width; }
+	/// Get the height of the solved map.
+	int GetHeight() const { return height; }
+private:
+	std::vector<std::array<float, 4>> Q_; ///< The optimal Q table.
+	int width = 0;
+	int height = 0;
+	float gamma;
+};
@@ -0,0 +1,71 @@
+#include "SparseTable.h"
+
+#include <cassert>
+
+
+SparseTable::SparseTable(float defaultQ) : defaultQ(defaultQ) {
+	Clear();
+}
+
+
+auto SparseTable::Find(uint32_t key) const -> const Entry* {
+	assert(key != emptyKey);
+	size_t mask = slots.size() - 1;
+	for (size_t i = Home(key); ; i = (i + 1) & mask) {
+		if (slots[i].key == key) {
+			return &slots[i].entry;
+		}
+		if (slots[i].key == emptyKey) {
+			return nullptr;
+		}
+	}
+}
+
+
+auto SparseTable::Insert(uint32_t key) -> Entry& {
+	assert(key != emptyKey);
+	size_t mask = slots.size() - 1;
+	size_t i = Home(key);
+	for (; slots[i].key != emptyKey; i = (i + 1) & mask) {
+		if (slots[i].key == key) {
+			return slots[i].entry;
+		}
+	}
+	if ((size + 1) * 10 > slots.size() * 7) {
+		Grow();
+		return Insert(key);
+	}
+	++size;
+	slots[i].key = key;
+	slots[i].entry = Entry{ { defaultQ, defaultQ, defaultQ, defaultQ }, { 0, 0, 0, 0 } };
+	return slots[i].entry;
+}
+
+
+void SparseTable::Clear() {
+	slots.assign(initialCapacity, Slot{ emptyKey, {} });
+	slots.shrink_to_fit();
+	size = 0;
+	shift = 64;
+	for (size_t capacity = initialCapacity; capacity > 1; capacity /= 2) {
+		--shift;
+	}
+}
+
+
+void SparseTable::Grow() {
+	std::vector<Slot> old(slots.size() * 2, Slot{ emptyKey, {} });
+	old.swap(slots);
+	--shift;
+	size_t mask = slots.size() - 1;
+	for (const Slot& slot : old) {
+		if (slot.key == emptyKey) {
+			continue;
+		}
+		size_t i = Home(slot.key);
+		while (slots[i].key != emptyKey) {
+			i = (i + 1) & mask;
+		}
+		slots[i] = slot;
+	}
+}
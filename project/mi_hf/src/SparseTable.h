@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// Q and N items of only the states that have been written, in a hash table.
+/// Open addressing with linear probing, keyed by the index of the field.
+/// States that are not in the table read as the default Q and zero visits.
+/// The table doubles when it gets 70% full, so its memory is proportional to
+/// the number of explored states instead of the area of the map.
+/// Not thread safe: an insert may move every entry.
+////////////////////////////////////////////////////////////////////////////////
+class SparseTable {
+public:
+	/// The Q and N items of a state.
+	struct Entry {
+		float q[4];
+		int n[4];
+	};
+public:
+	/// \param defaultQ The Q value of states that have not been written.
+	explicit SparseTable(float defaultQ = 0.0f);
+
+	/// Find the entry of a state.
+	/// \return The entry, or null if the state is not in the table.
+	const Entry* Find(uint32_t key) const;
+	/// Find the entry of a state, and insert a default one if it's not there.
+	/// The returned reference is valid until the next insert.
+	Entry& Insert(uint32_t key);
+	/// Remove every state, and release the memory of the table.
+	void Clear();
+
+	/// Get the Q value of states that have not been written.
+	float GetDefaultQ() const { return defaultQ; }
+	/// Get the number of states in the table.
+	size_t GetSize() const { return size; }
+	/// Get the number of slots in the table.
+	size_t GetCapacity() const { return slots.size(); }
+	/// Get the memory used by the slots in bytes.
+	size_t GetMemoryUsage() const { return slots.size() * sizeof(Slot); }
+private:
+	struct Slot {
+		uint32_t key;
+		Entry entry;
+	};
+	static constexpr uint32_t emptyKey = ~uint32_t(0);
+	static constexpr size_t initialCapacity = 64;
+
+	/// Index of the first slot to probe for a key.
+	size_t Home(uint32_t key) const { return (size_t)((key * 0x9E3779B97F4A7C15ull) >> shift); }
+	/// Double the capacity, and reinsert every entry.
+	void Grow();
+
+	std::vector<Slot> slots; ///< Power of two number of slots.
+	size_t size = 0; ///< Number of used slots.
+	int shift; ///< 64 minus log2 of the capacity, for Fibonacci hashing.
+	float defaultQ;
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// Lock-free ring buffer between a single producer and a single consumer
+/// thread. The capacity is a power of two, and the read and write positions
+/// only grow, so they also count the items ever pushed and popped. Each side
+/// keeps a copy of the other side's position, and only reloads it when the
+/// ring seems full or empty, so the two threads rarely touch the same cache
+/// line.
+////////////////////////////////////////////////////////////////////////////////
+template <class T>
+class SpscRing {
+public:
+	/// \param capacity The number of items, rounded up to a power of two.
+	explicit SpscRing(size_t capacity = 1024) { Reset(capacity); }
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	/// Drop every item and change the capacity.
+	/// Call while neither the producer nor the consumer use the ring.
+	void Reset(size_t capacity) {
+		size_t size = 1;
+		while (size < capacity) {
+			size *= 2;
+		}
+		items.assign(size, T());
+		mask = size - 1;
+		head.store(0);
+		tail.store(0);
+		cachedHead = 0;
+		cachedTail = 0;
+	}
+
+	/// Producer: append an item.
+	/// \return False if the ring is full.
+	bool Push(const T& item) {
+		size_t position = head.load(std::memory_order_relaxed);
+		if (position - cachedTail > mask) {
+			cachedTail = tail.load(std::memory_order_acquire);
+			if (position - cachedTail > mask) {
+				return false;
+			}
+		}
+		items[position & mask] = item;
+		head.store(position + 1, std::memory_order_release);
+		return true;
+	}
+	/// Producer: get wether Push would succeed.
+	bool IsFull() {
+		size_t position = head.load(std::memory_order_relaxed);
+		if (position - cachedTail > mask) {
+			cachedTail = tail.load(std::memory_order_acquire);
+		}
+		return position - cachedTail > mask;
+	}
+
+	/// Consumer: take the oldest item.
+	/// \return False if the ring is empty.
+	bool Pop(T& item) {
+		size_t position = tail.load(std::memory_order_relaxed);
+		if (position == cachedHead) {
+			cachedHead = head.load(std::memory_order_acquire);
+			if (position == cachedHead) {
+				return false;
+			}
+		}
+		item = items[position & mask];
+		tail.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// Get the number of items the ring can hold.
+	size_t GetCapacity() const { return mask + 1; }
+private:
+	std::vector<T> items;
+	size_t mask = 0;
+	alignas(64) std::atomic<size_t> head{ 0 }; ///< Next position to write, advanced by the producer.
+	size_t cachedTail = 0; ///< The producer's copy of tail.
+	alignas(64) std::atomic<size_t> tail{ 0 }; ///< Next position to read, advanced by the consumer.
+	size_t cachedHead = 0; ///< The consumer's copy of head.
+};
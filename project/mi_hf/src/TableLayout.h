@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// Maps the (x, y) coordinates of a map to indices of a per-state table.
+/// With the default row-major order, vertical neighbours are a whole row
+/// apart, so on wide maps every UP or DOWN move touches a new cache line.
+/// The other layouts keep nearby states nearby in memory in both directions:
+/// - TILED: the map is cut into 8x8 tiles, stored row-major one after the
+///		other, and the states of a tile are row-major inside it.
+/// - MORTON: the states are stored in Z-order, by interleaving the bits of x
+///		and y. The table covers the smallest power-of-two square around the
+///		map, so it wastes memory on elongated maps.
+////////////////////////////////////////////////////////////////////////////////
+class TableLayout {
+public:
+	enum eType {
+		ROW_MAJOR,
+		TILED,
+		MORTON,
+	};
+	static constexpr int tileBits = 3;
+	static constexpr int tileSize = 1 << tileBits;
+public:
+	TableLayout() = default;
+	/// \param type The order of the states.
+	/// \param width Width of the map.
+	/// \param height Height of the map.
+	TableLayout(eType type, int width, int height) : type(type), width(width) {
+		tilesX = (width + tileSize - 1) / tileSize;
+		int tilesY = (height + tileSize - 1) / tileSize;
+		switch (type) {
+			case ROW_MAJOR:
+				capacity = (size_t)width * height;
+				break;
+			case TILED:
+				capacity = (size_t)tilesX * tilesY * tileSize * tileSize;
+				break;
+			case MORTON: {
+				size_t side = 1;
+				while (side < (size_t)width || side < (size_t)height) {
+					side *= 2;
+				}
+				capacity = side * side;
+				break;
+			}
+		}
+	}
+
+	/// Get the index of the state at (x, y).
+	size_t Index(int x, int y) const {
+		switch (type) {
+			case TILED: {
+				size_t tile = (size_t)(y >> tileBits) * tilesX + (x >> tileBits);
+				return (tile << (2 * tileBits)) + ((y & (tileSize - 1)) << tileBits) + (x & (tileSize - 1));
+			}
+			case MORTON:
+				return Spread(x) | (Spread(y) << 1);
+			default:
+				return (size_t)y * width + x;
+		}
+	}
+
+	/// Get the number of table items required, including padding.
+	size_t GetCapacity() const { return capacity; }
+	/// Get the order of the states.
+	eType GetType() const { return type; }
+private:
+	/// Moves bit i of the value to bit 2i.
+	static uint64_t Spread(uint32_t value) {
+		uint64_t v = value;
+		v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+		v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+		v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+		v = (v | (v << 2)) & 0x3333333333333333ull;
+		v = (v | (v << 1)) & 0x5555555555555555ull;
+		return v;
+	}
+
+	eType type = ROW_MAJOR;
+	int width = 0;
+	int tilesX = 0;
+	size_t capacity = 0;
+};
@@ -0,0 +1,95 @@
+#include "Map.h"
+#include "TransitionModel.h"
+
+
+namespace {
+
+/// Action after a left turn, indexed by the original action.
+constexpr eAction turnLeft[4] = { LEFT, RIGHT, DOWN, UP };
+/// Action after a right turn, indexed by the original action.
+constexpr eAction turnRight[4] = { RIGHT, LEFT, UP, DOWN };
+/// Movement along x for each action.
+constexpr int deltaX[4] = { 0, 0, -1, 1 };
+/// Movement along y for each action.
+constexpr int deltaY[4] = { 1, -1, 0, 0 };
+
+}
+
+
+TransitionModel::TransitionModel(const Map& map) {
+	Build(map);
+}
+
+
+int TransitionModel::Next(const Map& map, int cell, eAction action, int outcome) {
+	const int width = map.GetWidth();
+	const int height = map.GetHeight();
+	const eAction moves[3] = { action, turnLeft[action], turnRight[action] };
+	int newx = cell % width + deltaX[moves[outcome]];
+	int newy = cell / width + deltaY[moves[outcome]];
+	if (0 <= newx && newx < width && 0 <= newy && newy < height
+		&& map.GetType(newx, newy) != Map::Field::WALL)
+	{
+		return newy*width + newx;
+	}
+	return cell;
+}
+
+
+void TransitionModel::Build(const Map& map) {
+	width = map.GetWidth();
+	height = map.GetHeight();
+	int numCells = width * height;
+
+	// whole rows of walls and terminal fields from the packed map
+	const int rowWords = map.GetRowWords();
+	std::vector<uint64_t> walls((size_t)height * rowWords);
+	std::vector<uint64_t> mines((size_t)height * rowWords);
+	std::vector<uint64_t> finishes((size_t)height * rowWords);
+	for (int y = 0; y < height; ++y) {
+		map.GetRowMask(y, Map::Field::WALL, &walls[(size_t)y * rowWords]);
+		map.GetRowMask(y, Map::Field::MINE, &mines[(size_t)y * rowWords]);
+		map.GetRowMask(y, Map::Field::FINISH, &finishes[(size_t)y * rowWords]);
+	}
+	auto test = [rowWords](const std::vector<uint64_t>& mask, int x, int y) {
+		return (mask[(size_t)y * rowWords + x / 64] >> (x % 64)) & 1;
+	};
+
+	rewards.resize(numCells);
+	terminals.resize(numCells);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			Map::Field field;
+			field.type = test(mines, x, y) ? Map::Field::MINE
+				: test(finishes, x, y) ? Map::Field::FINISH
+				: test(walls, x, y) ? Map::Field::WALL
+				: Map::Field::FREE;
+			rewards[y*width + x] = field.Reward();
+			terminals[y*width + x] = field.type == Map::Field::MINE || field.type == Map::Field::FINISH;
+		}
+	}
+
+	transitions.resize(numCells * 4);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			int cell = y*width + x;
+			for (int a = 0; a < 4; ++a) {
+				Transition& transition = transitions[cell * 4 + a];
+				const eAction moves[3] = { (eAction)a, turnLeft[a], turnRight[a] };
+				for (int outcome = 0; outcome < 3; ++outcome) {
+					int newx = x + deltaX[moves[outcome]];
+					int newy = y + deltaY[moves[outcome]];
+					int next = cell;
+					if (0 <= newx && newx < width && 0 <= newy && newy < height
+						&& !test(walls, newx, newy))
+					{
+						next = newy*width + newx;
+					}
+					transition.next[outcome] = next;
+					transition.reward[outcome] = rewards[next];
+					transition.terminal[outcome] = terminals[next];
+				}
+			}
+		}
+	}
+}
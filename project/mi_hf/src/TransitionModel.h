@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "Util.h"
+
+
+class Map;
+
+////////////////////////////////////////////////////////////////////////////////
+/// The compiled rules of the 'mines' problem for a given map.
+/// For every field and action, stores the three possible outcomes: the agent
+/// goes where it wanted, or slips to the left, or slips to the right. Each
+/// outcome has the index of the destination field, the reward of that field
+/// and wether the game ends there. Bumping into walls or the edge of the map
+/// leaves the agent in place.
+/// Fields are indexed row-major, as y*width + x.
+/// The model is a snapshot: build it again if the map changes.
+////////////////////////////////////////////////////////////////////////////////
+class TransitionModel {
+public:
+	/// Possible outcomes of an action.
+	enum eOutcome {
+		INTENDED = 0,
+		SLIP_LEFT = 1,
+		SLIP_RIGHT = 2,
+	};
+
+	/// The three outcomes of an action taken on a field.
+	struct Transition {
+		int32_t next[3]; ///< Index of the destination field.
+		float reward[3]; ///< Reward of the destination field.
+		uint8_t terminal[3]; ///< Wether the game is over at the destination.
+	};
+
+	/// Probability of slipping to either side.
+	static constexpr float slipProbability = 0.1f;
+public:
+	/// Create an empty model.
+	TransitionModel() = default;
+	/// Compile the model of a map.
+	explicit TransitionModel(const Map& map);
+
+	/// Compile the model of a map.
+	/// Overwrites any previous content.
+	void Build(const Map& map);
+
+	/// Get the outcomes of an action taken on a field.
+	/// \param cell Index of the field.
+	/// \param action The action.
+	const Transition& operator()(int cell, eAction action) const {
+		return transitions[cell * 4 + action];
+	}
+	/// Select an outcome by a uniform random number of [0, 1).
+	/// The lowest 10% is a right slip, the next 10% is a left slip, same as
+	/// the original rules of Game.
+	static int Outcome(float roll) {
+		return (roll < slipProbability) + (roll < 2 * slipProbability);
+	}
+	/// Get the destination of an outcome straight from the map, without
+	/// compiling it, same as the next field of the compiled transition.
+	/// \param map The map.
+	/// \param cell Index of the field the action is taken on.
+	/// \param action The action.
+	/// \param outcome The outcome, see eOutcome.
+	static int Next(const Map& map, int cell, eAction action, int outcome);
+
+	/// Get the reward of a field.
+	float Reward(int cell) const { return rewards[cell]; }
+	/// Get wether the game is over on a field.
+	bool Terminal(int cell) const { return terminals[cell] != 0; }
+
+	/// Get the width of the compiled map.
+	int GetWidth() const { return width; }
+	/// Get the height of the compiled map.
+	int GetHeight() const { return height; }
+	/// Get the number of fields of the compiled map.
+	int GetNumCells() const { return width * height; }
+private:
+	std::vector<Transition> transitions; ///< Outcomes of each (field, action), action is the minor index.
+	std::vector<float> rewards; ///< Reward of each field.
+	std::vector<uint8_t> terminals; ///< Wether the game ends on each field.
+	int width = 0;
+	int height = 0;
+};
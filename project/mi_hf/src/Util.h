@@ -1,14 +1,51 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
 
 #ifdef _MSC_VER
 #include <intrin.h>
 #endif
 
+/// Advances a SplitMix64 state and returns the next output.
+/// Used to expand a single seed into many.
+inline uint64_t SplitMix64(uint64_t& state) {
+	uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+/// State of the reproducible seeds, see SetDefaultSeed.
+inline std::atomic<uint64_t>& DefaultSeedState() {
+	static std::atomic<uint64_t> state{ 0 };
+	return state;
+}
+/// Wether SetDefaultSeed has been called.
+inline std::atomic<bool>& HasDefaultSeed() {
+	static std::atomic<bool> isSet{ false };
+	return isSet;
+}
+
+/// Make every following Seed() call return a seed derived from the given one.
+/// Objects that are seeded by default are then seeded the same way on every
+/// run, as long as they are created in the same order.
+inline void SetDefaultSeed(uint64_t seed) {
+	DefaultSeedState() = seed;
+	HasDefaultSeed() = true;
+}
+
 /// Generates a seed to be used to initialize random number engines.
-/// If compiled with MSVC, it reads the cpu's timestamp counter, which
-/// is pretty much perfect random for our uses.
+/// After SetDefaultSeed, it returns the next number of a SplitMix64 sequence.
+/// Otherwise, if compiled with MSVC, it reads the cpu's timestamp counter,
+/// which is pretty much perfect random for our uses.
 inline size_t Seed() {
+	if (HasDefaultSeed()) {
+		uint64_t state = DefaultSeedState().fetch_add(0x9E3779B97F4A7C15ull);
+		return (size_t)SplitMix64(state);
+	}
 #ifdef _MSC_VER
 	return (size_t)__rdtsc();
 #else
@@ -16,6 +53,15 @@ inline size_t Seed() {
 #endif
 }
 
+/// Hints the cpu to load the cache line of the address ahead of use.
+inline void Prefetch(const void* address) {
+#ifdef _MSC_VER
+	_mm_prefetch((const char*)address, _MM_HINT_T0);
+#else
+	__builtin_prefetch(address);
+#endif
+}
+
 /// The available actions in the 'mines' game.
 enum eAction {
 	UP = 0,
@@ -0,0 +1,211 @@
+#include "Visualization.h"
+#include "Agent.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+
+void ComputeStateValues(const Agent& agent, int width, int height, bool qMax, float* values, float& min, float& max) {
+	float minq = 0;
+	float maxq = 1;
+	for (int x = 0; x < width; x++) {
+		for (int y = 0; y < height; y++) {
+			float value;
+			if (qMax) {
+				value = agent.GetQMax(x, y);
+			}
+			else {
+				value = agent.GetNSum(x, y);
+			}
+			minq = std::min(value, minq);
+			maxq = std::max(value, maxq);
+			values[x + y*width] = value;
+		}
+	}
+	min = minq;
+	max = maxq;
+}
+
+
+namespace {
+
+constexpr float spread = 1 / 4.0f;
+constexpr float pi_rec = 1 / 3.14159265f;
+
+/// Weights of the sinc filter with a main bump of -4..4, from the center to
+/// lowPassRadius samples away.
+struct SincWeights {
+	SincWeights() {
+		weights[0] = spread * pi_rec;
+		total = spread * pi_rec;
+		for (intptr_t filter = 1; filter <= lowPassRadius; filter++) {
+			float w = (sin(filter*spread) / (filter*spread)) * spread * pi_rec;
+			weights[filter] = w;
+			total += w * 2;
+		}
+	}
+	float weights[lowPassRadius + 1];
+	float total; ///< Sum of the weights on both sides.
+};
+
+const SincWeights& GetSincWeights() {
+	static const SincWeights weights;
+	return weights;
+}
+
+}
+
+
+void SincLowPass(const float* input, size_t size, float* output) {
+	SincLowPass(input, size, 0, size, output);
+}
+
+
+void SincLowPass(const float* input, size_t size, size_t first, size_t last, float* output) {
+	const SincWeights& sinc = GetSincWeights();
+	intptr_t count = (intptr_t)size;
+	for (intptr_t i = (intptr_t)first; i < (intptr_t)last; i++) {
+		float y = input[i] * sinc.weights[0];
+		for (intptr_t filter = 1; filter <= lowPassRadius; filter++) {
+			intptr_t sample1 = i + filter;
+			intptr_t sample2 = i - filter;
+			sample1 = std::max((intptr_t)0, std::min(count - 1, sample1));
+			sample2 = std::max((intptr_t)0, std::min(count - 1, sample2));
+			y += (input[sample1] + input[sample2]) * sinc.weights[filter];
+		}
+		y /= sinc.total;
+
+		output[i - first] = y;
+	}
+}
+
+
+bool StreamingLowPass::Push(float sample, float& output) {
+	if (numSamples == 0) {
+		firstSample = sample;
+	}
+	ring[numSamples % ringSize] = sample;
+	++numSamples;
+	if (numSamples <= lowPassRadius) {
+		return false;
+	}
+
+	// the newest sample is the last one the center needs
+	const SincWeights& sinc = GetSincWeights();
+	size_t center = numSamples - 1 - lowPassRadius;
+	float y = ring[center % ringSize] * sinc.weights[0];
+	for (size_t filter = 1; filter <= lowPassRadius; filter++) {
+		float after = ring[(center + filter) % ringSize];
+		float before = filter <= center ? ring[(center - filter) % ringSize] : firstSample;
+		y += (after + before) * sinc.weights[filter];
+	}
+	output = y / sinc.total;
+	return true;
+}
+
+
+void MinMaxPyramid::Summary::Add(float value) {
+	if (count == 0) {
+		min = max = value;
+	}
+	else {
+		min = std::min(min, value);
+		max = std::max(max, value);
+	}
+	sum += value;
+	++count;
+}
+
+void MinMaxPyramid::Summary::Add(const Summary& other) {
+	if (other.count == 0) {
+		return;
+	}
+	if (count == 0) {
+		*this = other;
+		return;
+	}
+	min = std::min(min, other.min);
+	max = std::max(max, other.max);
+	sum += other.sum;
+	count += other.count;
+}
+
+void MinMaxPyramid::Attach(const float* samples) {
+	this->samples = samples;
+	size = 0;
+	levels.clear();
+}
+
+void MinMaxPyramid::Update(size_t newSize) {
+	if (levels.empty()) {
+		levels.emplace_back();
+	}
+	for (; size < newSize; ++size) {
+		// merge the sample into its bucket of each level, opening the ones it starts
+		size_t index = size / bucketSize;
+		bool opens = size % bucketSize == 0;
+		for (size_t level = 0; ; ++level) {
+			auto& buckets = levels[level];
+			if (opens) {
+				buckets.emplace_back();
+			}
+			buckets[index].Add(samples[size]);
+			if (buckets.size() == 1) {
+				break; // the top level, all the samples are in a single bucket
+			}
+			if (level + 1 == levels.size()) {
+				// the top level outgrew its bucket, summarize it a level higher
+				Summary top = buckets[0];
+				levels.emplace_back(1, top);
+			}
+			opens = opens && index % fanout == 0;
+			index /= fanout;
+		}
+	}
+}
+
+MinMaxPyramid::Summary MinMaxPyramid::Query(size_t first, size_t last) const {
+	Summary summary;
+	last = std::min(last, size);
+	if (first >= last) {
+		return summary;
+	}
+
+	// the samples outside whole buckets
+	while (first < last && first % bucketSize != 0) {
+		summary.Add(samples[first++]);
+	}
+	while (first < last && last % bucketSize != 0 && last != size) {
+		summary.Add(samples[--last]);
+	}
+	if (first >= last) {
+		return summary;
+	}
+
+	// the buckets of each level outside whole buckets of the next, the last
+	// bucket is whole if the range ends with the history
+	first /= bucketSize;
+	last = (last + bucketSize - 1) / bucketSize;
+	for (size_t level = 0; first < last; ++level) {
+		const auto& buckets = levels[level];
+		if (level + 1 == levels.size()) {
+			for (; first < last; ++first) {
+				summary.Add(buckets[first]);
+			}
+			break;
+		}
+		while (first < last && first % fanout != 0) {
+			summary.Add(buckets[first++]);
+		}
+		while (first < last && last % fanout != 0 && last != buckets.size()) {
+			summary.Add(buckets[--last]);
+		}
+		if (first >= last) {
+			break;
+		}
+		first /= fanout;
+		last = (last + fanout - 1) / fanout;
+	}
+	return summary;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class Agent;
+
+////////////////////////////////////////////////////////////////////////////////
+/// Data preparation of the interactive application's display, without any
+/// OpenGL, so that it can be measured on its own.
+////////////////////////////////////////////////////////////////////////////////
+
+/// Collect the value of each state for the color coding of the map.
+/// \param agent The agent to read the tables of.
+/// \param width Width of the agent's map.
+/// \param height Height of the agent's map.
+/// \param qMax True for the best Q value of each state, false for the sum of
+///		the visit counts.
+/// \param values [output] width*height values, row-major.
+/// \param min [output] The lowest value, but at most 0.
+/// \param max [output] The highest value, but at least 1.
+void ComputeStateValues(const Agent& agent, int width, int height, bool qMax, float* values, float& min, float& max);
+
+/// Number of samples on either side that the low-pass filter reads.
+constexpr int lowPassRadius = 29;
+
+/// Smooth the reward history with a windowed sinc low-pass filter.
+/// The main lobe of the sinc covers 4 samples to either side, and it is cut
+/// off after lowPassRadius samples. Samples past the ends repeat the first and
+/// the last.
+/// \param input The samples to filter.
+/// \param size The number of samples.
+/// \param output [output] The filtered samples, same size as the input.
+void SincLowPass(const float* input, size_t size, float* output);
+/// Smooth a range of the reward history, same as SincLowPass.
+/// \param input The samples to filter.
+/// \param size The number of samples.
+/// \param first The first sample to filter.
+/// \param last One past the last sample to filter.
+/// \param output [output] The filtered samples of the range, last - first items.
+void SincLowPass(const float* input, size_t size, size_t first, size_t last, float* output);
+
+////////////////////////////////////////////////////////////////////////////////
+/// The low-pass filter of SincLowPass, applied as the samples arrive.
+/// A filtered sample also depends on the lowPassRadius samples after it, so
+/// it becomes final with that much delay. From then on, the history can't
+/// change it, so it is computed only once, from a ring of the latest samples.
+/// The final samples are the same as those of SincLowPass over any longer
+/// history. The latest, not yet final ones can be filtered with SincLowPass
+/// over a range.
+////////////////////////////////////////////////////////////////////////////////
+class StreamingLowPass {
+public:
+	/// Forget every sample.
+	void Reset() { numSamples = 0; }
+	/// Add the next sample.
+	/// \param sample The sample.
+	/// \param output [output] The filtered value of sample GetNumFinal() - 1, if
+	///		it became final.
+	/// \return True if a filtered sample became final.
+	bool Push(float sample, float& output);
+
+	/// Get the number of samples added.
+	size_t GetNumSamples() const { return numSamples; }
+	/// Get the number of filtered samples that are final.
+	size_t GetNumFinal() const { return numSamples > lowPassRadius ? numSamples - lowPassRadius : 0; }
+private:
+	static constexpr size_t ringSize = 64; ///< Power of two, at least 2 * lowPassRadius + 1.
+	float ring[ringSize]; ///< Sample i is at i % ringSize.
+	float firstSample = 0; ///< Repeated before the start of the history.
+	size_t numSamples = 0;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// Min, max and mean of ranges of a growing history, for drawing it at any
+/// length and zoom with a bounded number of points.
+/// The samples are summarized in buckets of bucketSize samples, and each level
+/// above summarizes fanout buckets of the level below, so the summary of any
+/// range is merged from a few buckets of each level and the samples at its
+/// ends. The history is not copied, it is read from the attached array, whose
+/// items must not change once they are added.
+////////////////////////////////////////////////////////////////////////////////
+class MinMaxPyramid {
+public:
+	/// Min, max and mean of a range of samples.
+	struct Summary {
+		float min = 0;
+		float max = 0;
+		double sum = 0;
+		size_t count = 0;
+
+		/// Add a sample to the range.
+		void Add(float value);
+		/// Add a disjoint range to the range.
+		void Add(const Summary& other);
+		/// Get the mean of the range, 0 if it is empty.
+		float GetMean() const { return count > 0 ? (float)(sum / count) : 0.0f; }
+	};
+public:
+	/// Forget every sample, and read the history from an array.
+	/// \param samples The history, null for none.
+	void Attach(const float* samples);
+	/// Add the samples of the history up to a new size.
+	/// \param size Number of items of the history, not less than GetSize().
+	void Update(size_t size);
+	/// Get the number of samples added.
+	size_t GetSize() const { return size; }
+
+	/// Summarize a range of the samples added.
+	/// \param first The first sample of the range.
+	/// \param last One past the last sample of the range, at most GetSize().
+	/// \return The summary, with a count of 0 if the range is empty.
+	Summary Query(size_t first, size_t last) const;
+private:
+	static constexpr size_t bucketSize = 16; ///< Samples in a bucket of level 0.
+	static constexpr size_t fanout = 4; ///< Buckets of a level merged in a bucket of the next.
+	const float* samples = nullptr;
+	size_t size = 0;
+	std::vector<std::vector<Summary>> levels; ///< The last bucket of each level may be partial.
+};
@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Map.h"
+#include "Game.h"
+#include "Agent.h"
+#include "Visualization.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+/// Parameters of a benchmark run.
+struct BenchOptions {
+	std::vector<int> sizes = { 10, 64, 256, 1024, 4096 }; ///< Square map sizes.
+	std::vector<int> historySizes = { 1000, 10000, 100000, 1000000 }; ///< Reward history lengths of the low-pass.
+	int numSamples = 7;
+	double sampleSeconds = 0.02; ///< Minimum duration of a sample.
+	TableLayout::eType layout = TableLayout::ROW_MAJOR;
+	std::string storage = "separate";
+	std::string jsonPath = "mi_hf_bench.json";
+};
+
+/// Timing of a benchmark, per call.
+struct Result {
+	std::string name;
+	std::string variant; ///< Further parameters, such as the map density.
+	int width = 0;
+	int height = 0;
+	long long callsPerSample = 0;
+	std::vector<double> nsPerCall; ///< One item per sample.
+	double min = 0;
+	double median = 0;
+	double mean = 0;
+	double stddev = 0;
+};
+
+
+void PrintUsage(const char* program) {
+	cout << "usage: " << program << " [options]" << endl
+		<< "  --sizes LIST    comma separated square map sizes (default 10,64,256,1024,4096)" << endl
+		<< "  --history LIST  comma separated reward history lengths of the low-pass" << endl
+		<< "                  (default 1000,10000,100000,1000000)" << endl
+		<< "  --samples N     number of timed samples of each benchmark (default 7)" << endl
+		<< "  --sample-time X minimum seconds per sample (default 0.02)" << endl
+		<< "  --layout L      order of the Q and N tables: row, tiled or morton (default row)" << endl
+		<< "  --storage S     separate, interleaved, quantized or sparse (default separate)" << endl
+		<< "  --json FILE     where to write the results (default mi_hf_bench.json)" << endl;
+}
+
+/// Parse a comma separated list of positive numbers.
+/// \return False if the list is empty or malformed.
+bool ParseList(const std::string& text, std::vector<int>& list) {
+	list.clear();
+	std::istringstream is(text);
+	std::string item;
+	while (std::getline(is, item, ',')) {
+		int value = std::atoi(item.c_str());
+		if (value <= 0) {
+			return false;
+		}
+		list.push_back(value);
+	}
+	return !list.empty();
+}
+
+/// Parses the command line into options.
+/// \return False if the command line is malformed or help was requested.
+bool ParseArguments(int argc, char** argv, BenchOptions& options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h" || i + 1 >= argc) {
+			return false;
+		}
+		std::string value = argv[++i];
+		if (arg == "--sizes") {
+			if (!ParseList(value, options.sizes)) {
+				return false;
+			}
+			for (int& size : options.sizes) {
+				size = std::max(2, size);
+			}
+		}
+		else if (arg == "--history") {
+			if (!ParseList(value, options.historySizes)) {
+				return false;
+			}
+		}
+		else if (arg == "--samples") {
+			options.numSamples = std::max(1, std::atoi(value.c_str()));
+		}
+		else if (arg == "--sample-time") {
+			options.sampleSeconds = std::atof(value.c_str());
+		}
+		else if (arg == "--layout") {
+			if (value == "row") {
+				options.layout = TableLayout::ROW_MAJOR;
+			}
+			else if (value == "tiled") {
+				options.layout = TableLayout::TILED;
+			}
+			else if (value == "morton") {
+				options.layout = TableLayout::MORTON;
+			}
+			else {
+				cerr << "unknown layout " << value << endl;
+				return false;
+			}
+		}
+		else if (arg == "--storage") {
+			if (value != "separate" && value != "interleaved" && value != "quantized" && value != "sparse") {
+				cerr << "unknown storage " << value << endl;
+				return false;
+			}
+			options.storage = value;
+		}
+		else if (arg == "--json") {
+			options.jsonPath = value;
+		}
+		else {
+			cerr << "unknown option " << arg << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+const char* LayoutName(TableLayout::eType type) {
+	switch (type) {
+		case TableLayout::TILED: return "tiled";
+		case TableLayout::MORTON: return "morton";
+		default: return "row";
+	}
+}
+
+/// Times a function that performs a given number of calls.
+/// The number of calls per sample is doubled until a sample takes at least
+/// the minimum time, then the samples are taken. Maps too big for that take a
+/// single call per sample.
+/// \param run Called with the number of calls to perform.
+template <class Function>
+Result Measure(const BenchOptions& options, const std::string& name, const std::string& variant,
+	int width, int height, Function&& run)
+{
+	using clock = std::chrono::steady_clock;
+	auto time = [&run](long long count) {
+		auto start = clock::now();
+		run(count);
+		return std::chrono::duration<double>(clock::now() - start).count();
+	};
+
+	Result result;
+	result.name = name;
+	result.variant = variant;
+	result.width = width;
+	result.height = height;
+
+	long long count = 1;
+	double seconds = time(count); // also warms up
+	while (seconds < options.sampleSeconds) {
+		count *= 2;
+		seconds = time(count);
+	}
+	result.callsPerSample = count;
+	for (int i = 0; i < options.numSamples; ++i) {
+		result.nsPerCall.push_back(1e9 * time(count) / count);
+	}
+
+	std::vector<double> sorted = result.nsPerCall;
+	std::sort(sorted.begin(), sorted.end());
+	size_t n = sorted.size();
+	result.min = sorted.front();
+	result.median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+	double sum = 0, sumSquares = 0;
+	for (double value : sorted) {
+		sum += value;
+		sumSquares += value * value;
+	}
+	result.mean = sum / n;
+	result.stddev = n > 1 ? std::sqrt(std::max(0.0, (sumSquares - sum * sum / n) / (n - 1))) : 0;
+
+	std::ostringstream size;
+	if (width > 0) {
+		size << width << "x" << height;
+	}
+	cout << std::left << std::setw(21) << name << std::setw(16) << variant << std::right
+		<< std::setw(11) << size.str()
+		<< std::fixed << std::setprecision(1)
+		<< std::setw(14) << result.median
+		<< std::setw(14) << result.min
+		<< std::setw(11) << (result.mean > 0 ? 100 * result.stddev / result.mean : 0) << "%" << endl;
+	return result;
+}
+
+/// Generate a map the same way as the trainer does, with a share of the
+/// fields being walls and mines, half each.
+void CreateMap(Map& map, int width, int height, double density, size_t seed) {
+	int numBlocked = (int)(density * width * height);
+	map.Resize(width, height);
+	map.SetSeed(seed);
+	map.Generate(numBlocked / 2, numBlocked - numBlocked / 2);
+	map(width - 1, height - 1).type = Map::Field::FINISH;
+	map(0, 0).type = Map::Field::FREE;
+}
+
+/// Set up an agent according to the options, to learn on a game.
+void SetupAgent(Agent& agent, Game& game, const BenchOptions& options) {
+	agent.SetSeed(3);
+	agent.SetLayout(options.layout);
+	agent.SetInterleaved(options.storage == "interleaved");
+	agent.SetQuantized(options.storage == "quantized");
+	agent.SetSparse(options.storage == "sparse");
+	agent.SetGame(&game);
+}
+
+/// Benchmarks of the game and the agent on a map of a size.
+void BenchmarkMap(const BenchOptions& options, int size, std::vector<Result>& results) {
+	for (double density : { 0.0, 0.1, 0.3 }) {
+		Map map(size, size);
+		std::ostringstream variant;
+		variant << "density " << density;
+		size_t seed = 1;
+		results.push_back(Measure(options, "Map::Generate", variant.str(), size, size, [&](long long count) {
+			for (long long i = 0; i < count; ++i) {
+				CreateMap(map, size, size, density, seed++);
+			}
+		}));
+	}
+
+	Map map(size, size);
+	CreateMap(map, size, size, 0.1, 1);
+	auto game = std::make_unique<Game>();
+	game->SetSeed(2);
+	game->SetMap(&map);
+	game->NewGame();
+
+	// a random walk, restarted whenever it ends
+	std::mt19937 rne(4);
+	std::vector<eAction> actions(4096);
+	for (auto& action : actions) {
+		action = (eAction)(rne() >> 30);
+	}
+	size_t next = 0;
+	results.push_back(Measure(options, "Game::PerformAction", "", size, size, [&](long long count) {
+		for (long long i = 0; i < count; ++i) {
+			if (game->PerformAction(actions[next++ & (actions.size() - 1)])) {
+				game->NewGame();
+			}
+		}
+	}));
+
+	auto agent = std::make_unique<Agent>();
+	SetupAgent(*agent, *game, options);
+	std::string config = std::string(LayoutName(options.layout)) + " " + options.storage;
+	game->NewGame();
+	agent->StartEpisode();
+	results.push_back(Measure(options, "Agent::Step", config, size, size, [&](long long count) {
+		for (long long i = 0; i < count; ++i) {
+			if (game->Ended()) {
+				game->NewGame();
+				agent->StartEpisode();
+			}
+			agent->Step();
+		}
+	}));
+
+	// the agent's tables are no longer empty after the steps
+	int x = game->GetCurrentX();
+	int y = game->GetCurrentY();
+	eAction sink = UP;
+	results.push_back(Measure(options, "SelectNextStep", config, size, size, [&](long long count) {
+		for (long long i = 0; i < count; ++i) {
+			sink = agent->SelectNextStep(x, y);
+		}
+	}));
+	if (sink > RIGHT) {
+		cout << "unexpected action" << endl;
+	}
+
+	std::unique_ptr<float[]> values(new float[(size_t)size * size]);
+	float min, max;
+	for (bool qMax : { true, false }) {
+		results.push_back(Measure(options, "RefreshQvalues", qMax ? "Q max" : "N sum", size, size, [&](long long count) {
+			for (long long i = 0; i < count; ++i) {
+				ComputeStateValues(*agent, size, size, qMax, values.get(), min, max);
+			}
+		}));
+	}
+}
+
+/// Benchmark of the reward graph's low-pass filter and summaries on a history
+/// length. A frame of the graph summarizes 1600 columns of the whole history.
+void BenchmarkLowPass(const BenchOptions& options, int numItems, std::vector<Result>& results) {
+	std::mt19937 rne(5);
+	std::normal_distribution<float> noise(0.0f, 0.5f);
+	std::vector<float> history(numItems), filtered(numItems);
+	for (int i = 0; i < numItems; ++i) {
+		history[i] = 1.0f - 2.0f * std::exp(-i / (0.1f * numItems)) + noise(rne);
+	}
+	std::ostringstream variant;
+	variant << numItems << " items";
+	results.push_back(Measure(options, "SincLowPass", variant.str(), 0, 0, [&](long long count) {
+		for (long long i = 0; i < count; ++i) {
+			SincLowPass(history.data(), history.size(), filtered.data());
+		}
+	}));
+
+	MinMaxPyramid pyramid;
+	pyramid.Attach(history.data());
+	pyramid.Update(history.size());
+	const size_t numColumns = 1600;
+	float sink = 0;
+	results.push_back(Measure(options, "MinMaxPyramid::Query", variant.str(), 0, 0, [&](long long count) {
+		for (long long i = 0; i < count; ++i) {
+			for (size_t c = 0; c < numColumns; ++c) {
+				sink += pyramid.Query(history.size() * c / numColumns, history.size() * (c + 1) / numColumns).GetMean();
+			}
+		}
+	}));
+	if (std::isnan(sink)) {
+		cout << "unexpected mean" << endl;
+	}
+}
+
+/// Write the results as JSON.
+/// \return False if the file can't be written.
+bool WriteJson(const std::string& path, const BenchOptions& options, const std::vector<Result>& results) {
+	std::ofstream file(path);
+	if (!file) {
+		return false;
+	}
+	file << std::setprecision(6);
+	file << "{" << endl
+		<< "  \"unit\": \"ns per call\"," << endl
+		<< "  \"layout\": \"" << LayoutName(options.layout) << "\"," << endl
+		<< "  \"storage\": \"" << options.storage << "\"," << endl
+		<< "  \"samples\": " << options.numSamples << "," << endl
+		<< "  \"results\": [" << endl;
+	for (size_t i = 0; i < results.size(); ++i) {
+		const auto& result = results[i];
+		file << "    { \"name\": \"" << result.name << "\""
+			<< ", \"variant\": \"" << result.variant << "\""
+			<< ", \"width\": " << result.width
+			<< ", \"height\": " << result.height
+			<< ", \"calls_per_sample\": " << result.callsPerSample
+			<< ", \"min\": " << result.min
+			<< ", \"median\": " << result.median
+			<< ", \"mean\": " << result.mean
+			<< ", \"stddev\": " << result.stddev
+			<< ", \"samples\": [";
+		for (size_t j = 0; j < result.nsPerCall.size(); ++j) {
+			file << (j ? ", " : "") << result.nsPerCall[j];
+		}
+		file << "] }" << (i + 1 < results.size() ? "," : "") << endl;
+	}
+	file << "  ]" << endl << "}" << endl;
+	return (bool)file;
+}
+
+
+int main(int argc, char** argv) {
+	BenchOptions options;
+	if (!ParseArguments(argc, argv, options)) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	std::vector<Result> results;
+	cout << "benchmark            variant                 map     median ns        min ns    stddev" << endl;
+	for (int size : options.sizes) {
+		BenchmarkMap(options, size, results);
+	}
+	for (int numItems : options.historySizes) {
+		BenchmarkLowPass(options, numItems, results);
+	}
+
+	if (!WriteJson(options.jsonPath, options, results)) {
+		cerr << "could not write " << options.jsonPath << endl;
+		return 1;
+	}
+	cout << "results written to " << options.jsonPath << endl;
+	return 0;
+}
@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Map.h"
+#include "Game.h"
+#include "Agent.h"
+#include "MapGenerator.h"
+#include "Solver.h"
+#include "TransitionModel.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+/// Parameters of a benchmark run.
+struct BenchOptions {
+	std::vector<int> sizes = { 8, 16, 32, 64 }; ///< Square map sizes.
+	std::vector<double> densities = { 0.05, 0.15, 0.25 }; ///< Share of walls and mines, half each.
+	int numSeeds = 3; ///< Maps of each size and density.
+	int maxEpisodes = 100000; ///< Give up on a map after this many episodes.
+	int interval = 10; ///< Episodes between evaluations of the greedy policy.
+	float threshold = 0.95f; ///< Share of the optimal return to reach.
+	std::string jsonPath = "mi_hf_bench_convergence.json";
+};
+
+/// Outcome of teaching on a map.
+struct Result {
+	int width = 0;
+	int height = 0;
+	double density = 0;
+	size_t seed = 0;
+	float optimalReturn = 0; ///< Of the optimal policy, by value iteration.
+	float randomReturn = 0; ///< Of the uniform random policy.
+	float finalReturn = 0; ///< Of the greedy policy at the end.
+	bool reached = false; ///< Wether the threshold was reached.
+	int episodes = 0; ///< Episodes played until the threshold was reached, or in total.
+	long long steps = 0;
+	double seconds = 0; ///< Wall time of the teaching, without the evaluations.
+};
+
+
+void PrintUsage(const char* program) {
+	cout << "usage: " << program << " [options]" << endl
+		<< "  --sizes LIST     comma separated square map sizes (default 8,16,32,64)" << endl
+		<< "  --densities LIST comma separated shares of walls and mines (default 0.05,0.15,0.25)" << endl
+		<< "  --seeds N        maps of each size and density, seeded 1..N (default 3)" << endl
+		<< "  --episodes N     episodes before giving up on a map (default 100000)" << endl
+		<< "  --interval N     episodes between evaluations of the greedy policy (default 10)" << endl
+		<< "  --threshold X    share of the optimal return to reach (default 0.95)" << endl
+		<< "  --json FILE      where to write the results (default mi_hf_bench_convergence.json)" << endl;
+}
+
+/// Parse a comma separated list of numbers.
+/// \return False if the list is empty.
+template <class T>
+bool ParseList(const std::string& text, std::vector<T>& list) {
+	list.clear();
+	std::istringstream is(text);
+	std::string item;
+	while (std::getline(is, item, ',')) {
+		list.push_back((T)std::atof(item.c_str()));
+	}
+	return !list.empty();
+}
+
+/// Parses the command line into options.
+/// \return False if the command line is malformed or help was requested.
+bool ParseArguments(int argc, char** argv, BenchOptions& options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h" || i + 1 >= argc) {
+			return false;
+		}
+		std::string value = argv[++i];
+		if (arg == "--sizes") {
+			if (!ParseList(value, options.sizes)) {
+				return false;
+			}
+			for (int& size : options.sizes) {
+				size = std::max(2, size);
+			}
+		}
+		else if (arg == "--densities") {
+			if (!ParseList(value, options.densities)) {
+				return false;
+			}
+		}
+		else if (arg == "--seeds") {
+			options.numSeeds = std::atoi(value.c_str());
+		}
+		else if (arg == "--episodes") {
+			options.maxEpisodes = std::atoi(value.c_str());
+		}
+		else if (arg == "--interval") {
+			options.interval = std::atoi(value.c_str());
+		}
+		else if (arg == "--threshold") {
+			options.threshold = (float)std::atof(value.c_str());
+		}
+		else if (arg == "--json") {
+			options.jsonPath = value;
+		}
+		else {
+			cerr << "unknown option " << arg << endl;
+			return false;
+		}
+	}
+	return options.numSeeds > 0 && options.maxEpisodes > 0 && options.interval > 0;
+}
+
+/// The greedy policy of the agent, the first action with the highest Q
+/// value on each field, same as the agent picks when not exploring.
+void GreedyPolicy(const Agent& agent, int width, int height, std::vector<eAction>& policy) {
+	policy.resize((size_t)width * height);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			eAction best = UP;
+			for (int a = 1; a < 4; ++a) {
+				if (agent.GetQ(x, y, best) < agent.GetQ(x, y, (eAction)a)) {
+					best = (eAction)a;
+				}
+			}
+			policy[y*width + x] = best;
+		}
+	}
+}
+
+/// Teach an agent on a map, the same way as the trainer's serial mode, until
+/// its greedy policy earns the threshold share of the optimal return.
+/// The share is measured between the random and the optimal policy, so that
+/// it is meaningful for negative returns:
+///		(return - random) / (optimal - random)
+Result TeachUntilOptimal(const BenchOptions& options, int size, double density, size_t seed) {
+	Result result;
+	result.width = size;
+	result.height = size;
+	result.density = density;
+	result.seed = seed;
+
+	Map map(size, size);
+	MapGenerator generator;
+	generator.SetSeed(seed);
+	int numBlocked = (int)(density * size * size);
+	generator.Generate(map, numBlocked / 2, numBlocked - numBlocked / 2);
+
+	TransitionModel model(map);
+	Solver solver;
+	solver.Solve(model);
+	result.optimalReturn = solver.GetQMax(0, 0);
+	result.randomReturn = solver.Evaluate(model, nullptr);
+	float target = result.randomReturn + options.threshold * (result.optimalReturn - result.randomReturn);
+
+	Game game;
+	Agent agent;
+	game.SetSeed(seed + 1);
+	agent.SetSeed(seed + 2);
+	game.SetMap(&map);
+	agent.SetGame(&game);
+
+	std::vector<eAction> policy;
+	double seconds = 0;
+	int episode = 0;
+	while (episode < options.maxEpisodes) {
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < options.interval && episode < options.maxEpisodes; ++i, ++episode) {
+			game.NewGame();
+			agent.StartEpisode();
+			while (!game.Ended()) {
+				agent.Step();
+				++result.steps;
+			}
+			agent.EndEpisode();
+		}
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		GreedyPolicy(agent, size, size, policy);
+		result.finalReturn = solver.Evaluate(model, policy.data());
+		if (result.finalReturn >= target) {
+			result.reached = true;
+			break;
+		}
+	}
+	result.episodes = episode;
+	result.seconds = seconds;
+	return result;
+}
+
+/// Write the results as JSON.
+/// \return False if the file can't be written.
+bool WriteJson(const std::string& path, const BenchOptions& options, const std::vector<Result>& results) {
+	std::ofstream file(path);
+	if (!file) {
+		return false;
+	}
+	file << std::setprecision(6);
+	file << "{" << endl
+		<< "  \"threshold\": " << options.threshold << "," << endl
+		<< "  \"interval\": " << options.interval << "," << endl
+		<< "  \"max_episodes\": " << options.maxEpisodes << "," << endl
+		<< "  \"results\": [" << endl;
+	for (size_t i = 0; i < results.size(); ++i) {
+		const auto& result = results[i];
+		file << "    { \"width\": " << result.width
+			<< ", \"height\": " << result.height
+			<< ", \"density\": " << result.density
+			<< ", \"seed\": " << result.seed
+			<< ", \"optimal_return\": " << result.optimalReturn
+			<< ", \"random_return\": " << result.randomReturn
+			<< ", \"final_return\": " << result.finalReturn
+			<< ", \"reached\": " << (result.reached ? "true" : "false")
+			<< ", \"episodes\": " << result.episodes
+			<< ", \"steps\": " << result.steps
+			<< ", \"seconds\": " << result.seconds
+			<< " }" << (i + 1 < results.size() ? "," : "") << endl;
+	}
+	file << "  ]" << endl << "}" << endl;
+	return (bool)file;
+}
+
+
+int main(int argc, char** argv) {
+	BenchOptions options;
+	if (!ParseArguments(argc, argv, options)) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	std::vector<Result> results;
+	cout << "    map   density  seed   optimal    random     final   episodes       steps   time [s]" << endl;
+	for (int size : options.sizes) {
+		for (double density : options.densities) {
+			for (int seed = 1; seed <= options.numSeeds; ++seed) {
+				Result result = TeachUntilOptimal(options, size, density, seed);
+				std::ostringstream map;
+				map << size << "x" << size;
+				cout << std::setw(7) << map.str()
+					<< std::fixed << std::setprecision(2) << std::setw(10) << result.density
+					<< std::setw(6) << result.seed
+					<< std::setprecision(3)
+					<< std::setw(10) << result.optimalReturn
+					<< std::setw(10) << result.randomReturn
+					<< std::setw(10) << result.finalReturn
+					<< std::setw(11) << result.episodes << (result.reached ? " " : "+")
+					<< std::setw(11) << result.steps
+					<< std::setw(11) << result.seconds << endl;
+				results.push_back(result);
+			}
+		}
+	}
+
+	if (!WriteJson(options.jsonPath, options, results)) {
+		cerr << "could not write " << options.jsonPath << endl;
+		return 1;
+	}
+	cout << "results written to " << options.jsonPath << endl;
+	return 0;
+}
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+
+#include "Map.h"
+#include "Game.h"
+#include "Agent.h"
+#include "FixedSize.h"
+
+using std::cout;
+using std::endl;
+
+/// Episodes and elapsed time of a teaching session.
+struct Session {
+	std::vector<float> rewards;
+	long long numSteps = 0;
+	double seconds = 0;
+};
+
+/// Teach an agent for a number of episodes, like the trainer's serial mode.
+template <class GameType, class AgentType>
+Session Teach(GameType& game, AgentType& agent, int numEpisodes) {
+	Session session;
+	session.rewards.reserve(numEpisodes);
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < numEpisodes; ++i) {
+		game.NewGame();
+		agent.StartEpisode();
+		while (!game.Ended()) {
+			agent.Step();
+			++session.numSteps;
+		}
+		session.rewards.push_back(agent.EndEpisode());
+	}
+	auto end = std::chrono::steady_clock::now();
+	session.seconds = std::chrono::duration<double>(end - start).count();
+	return session;
+}
+
+/// Generate a map the same way as the trainer does.
+void CreateMap(Map& map, int width, int height, int numWalls, int numMines) {
+	map.Resize(width, height);
+	map.SetSeed(1);
+	map.Generate(numWalls, numMines);
+	map(width - 1, height - 1).type = Map::Field::FINISH;
+	map(0, 0).type = Map::Field::FREE;
+}
+
+/// Teach the dynamic and the compiled agent on the same map with the same
+/// seeds, and print the time per step of both.
+template <int W, int H>
+void Compare(int numWalls, int numMines, int numEpisodes) {
+	Map map(W, H);
+	CreateMap(map, W, H, numWalls, numMines);
+
+	Game game;
+	Agent agent;
+	game.SetSeed(2);
+	agent.SetSeed(3);
+	game.SetMap(&map);
+	agent.SetGame(&game);
+	Session dynamic = Teach(game, agent, numEpisodes);
+
+	auto model = std::make_unique<FixedModel<W, H>>();
+	auto fixedGame = std::make_unique<FixedGame<W, H>>();
+	auto fixedAgent = std::make_unique<FixedAgent<W, H>>();
+	model->Build(map);
+	fixedGame->SetSeed(2);
+	fixedAgent->SetSeed(3);
+	fixedGame->SetModel(model.get());
+	fixedAgent->SetGame(fixedGame.get());
+	Session fixed = Teach(*fixedGame, *fixedAgent, numEpisodes);
+
+	double dynamicNs = 1e9 * dynamic.seconds / dynamic.numSteps;
+	double fixedNs = 1e9 * fixed.seconds / fixed.numSteps;
+	cout << std::setw(4) << W << "x" << std::left << std::setw(4) << H << std::right
+		<< std::setw(10) << dynamic.numSteps
+		<< std::fixed << std::setprecision(2)
+		<< std::setw(14) << dynamicNs
+		<< std::setw(12) << fixedNs
+		<< std::setw(10) << dynamicNs / fixedNs << "x"
+		<< std::setw(11) << (dynamic.rewards == fixed.rewards ? "yes" : "NO") << endl;
+}
+
+
+int main() {
+	cout << "     map     steps   dynamic ns   fixed ns   speedup   identical" << endl;
+	Compare<10, 10>(5, 5, 400000);
+	Compare<64, 64>(200, 200, 20000);
+	return 0;
+}
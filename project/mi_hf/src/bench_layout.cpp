@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+#include "Map.h"
+#include "Game.h"
+#include "Agent.h"
+#include "TableLayout.h"
+
+using std::cout;
+using std::endl;
+
+/// Set associative cache with LRU replacement, counts the misses of an
+/// address trace.
+class CacheSimulator {
+public:
+	/// \param size Capacity in bytes.
+	/// \param ways Associativity.
+	/// \param lineSize Size of a cache line in bytes.
+	CacheSimulator(size_t size, int ways, int lineSize = 64) :
+		ways(ways),
+		lineBits(0),
+		numSets(size / lineSize / ways),
+		tags(numSets * ways, ~uint64_t(0)),
+		ages(numSets * ways, 0)
+	{
+		while ((1 << lineBits) < lineSize) {
+			++lineBits;
+		}
+	}
+
+	/// Access an address.
+	/// \return True if it was a miss.
+	bool Access(uint64_t address) {
+		uint64_t line = address >> lineBits;
+		size_t set = line % numSets;
+		uint64_t* setTags = &tags[set * ways];
+		uint64_t* setAges = &ages[set * ways];
+		++clock;
+		int victim = 0;
+		for (int i = 0; i < ways; ++i) {
+			if (setTags[i] == line) {
+				setAges[i] = clock;
+				return false;
+			}
+			if (setAges[i] < setAges[victim]) {
+				victim = i;
+			}
+		}
+		++numMisses;
+		setTags[victim] = line;
+		setAges[victim] = clock;
+		return true;
+	}
+
+	uint64_t GetNumMisses() const { return numMisses; }
+private:
+	int ways;
+	int lineBits;
+	size_t numSets;
+	std::vector<uint64_t> tags;
+	std::vector<uint64_t> ages;
+	uint64_t clock = 0;
+	uint64_t numMisses = 0;
+};
+
+const char* LayoutName(TableLayout::eType type) {
+	switch (type) {
+		case TableLayout::TILED: return "tiled";
+		case TableLayout::MORTON: return "morton";
+		default: return "row-major";
+	}
+}
+
+/// Walks uniformly at random, so that half of the moves are vertical, and
+/// calls visit(x, y, action, newx, newy) for each step. The same seed gives
+/// the same walk.
+template <class Visit>
+void RandomWalk(int width, int height, int numSteps, Visit&& visit) {
+	std::mt19937 rne(42);
+	int x = width / 2;
+	int y = height / 2;
+	constexpr int deltaX[4] = { 0, 0, -1, 1 };
+	constexpr int deltaY[4] = { 1, -1, 0, 0 };
+	for (int i = 0; i < numSteps; ++i) {
+		int action = rne() >> 30;
+		int newx = std::min(width - 1, std::max(0, x + deltaX[action]));
+		int newy = std::min(height - 1, std::max(0, y + deltaY[action]));
+		visit(x, y, action, newx, newy);
+		x = newx;
+		y = newy;
+	}
+}
+
+/// Replays the Q and N table accesses of Agent::Step for a random walk
+/// through a simulated L1 and L2 cache.
+/// The miss rates are relative to all accesses.
+/// With interleaved storage, the Q and N items of a state share a 32 byte
+/// record, otherwise they are in separate tables.
+void SimulateWalk(TableLayout layout, bool interleaved, int width, int height, int numSteps, double& l1MissRate, double& l2MissRate) {
+	const uint64_t itemSize = interleaved ? 32 : 16; // four floats or four ints, or both
+	const uint64_t baseQ = 0;
+	const uint64_t baseN = interleaved ? 16 : (layout.GetCapacity() * itemSize + 4095) & ~uint64_t(4095);
+
+	CacheSimulator l1(32 * 1024, 8);
+	CacheSimulator l2(1024 * 1024, 16);
+	auto access = [&](uint64_t address) {
+		if (l1.Access(address)) {
+			l2.Access(address);
+		}
+	};
+
+	RandomWalk(width, height, numSteps, [&](int x, int y, int, int newx, int newy) {
+		access(baseQ + layout.Index(x, y) * itemSize); // select action, Q old
+		access(baseN + layout.Index(x, y) * itemSize); // N increment
+		access(baseQ + layout.Index(newx, newy) * itemSize); // Q max of next
+	});
+	l1MissRate = (double)l1.GetNumMisses() / (3.0 * numSteps);
+	l2MissRate = (double)l2.GetNumMisses() / (3.0 * numSteps);
+}
+
+/// Replays the same random walk as SimulateWalk on the tables of an Agent,
+/// with the table accesses and the update of Agent::Step, and measures the
+/// time per step. The time and the miss rates then describe the same
+/// accesses. Agent::Step itself is not timed: an epsilon-greedy agent stays in
+/// a small part of the map, which fits in the cache with any layout.
+/// The time includes the index computation, which is a few shifts and masks
+/// more for Morton order than for the other layouts, so fewer misses only pay
+/// off once the walk leaves the L2 cache.
+double TimeWalk(TableLayout::eType layout, bool interleaved, int width, int height, int numSteps) {
+	Map map(width, height);
+	map.SetSeed(1);
+	map.Generate(0, 0);
+	map(width - 1, height - 1).type = Map::Field::FINISH;
+
+	Game game;
+	Agent agent;
+	agent.SetLayout(layout);
+	agent.SetInterleaved(interleaved);
+	game.SetMap(&map);
+	agent.SetGame(&game);
+
+	auto start = std::chrono::steady_clock::now();
+	RandomWalk(width, height, numSteps, [&](int x, int y, int action, int newx, int newy) {
+		// the greedy choice reads the Q values of the state, then the update
+		// reads the best Q value of the next state
+		float qBest = agent.GetQMax(x, y);
+		float qMax = agent.GetQMax(newx, newy);
+		int n = agent.GetN(x, y, (eAction)action);
+		agent.SetEntry(x, y, (eAction)action, qBest + 0.2f * (-0.04f + 0.98f * qMax - qBest), n + 1);
+	});
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / numSteps;
+}
+
+
+int main() {
+	const int sizes[] = { 128, 512, 2048 };
+	const TableLayout::eType layouts[] = { TableLayout::ROW_MAJOR, TableLayout::TILED, TableLayout::MORTON };
+	constexpr int numSimulatedSteps = 4000000;
+	constexpr int numTimedSteps = 4000000;
+
+	cout << "     map     layout      storage   L1 miss   L2 miss   ns/step" << endl;
+	for (int size : sizes) {
+		for (auto type : layouts) {
+			for (bool interleaved : { false, true }) {
+				double l1MissRate, l2MissRate;
+				SimulateWalk(TableLayout(type, size, size), interleaved, size, size, numSimulatedSteps, l1MissRate, l2MissRate);
+				double nsPerStep = TimeWalk(type, interleaved, size, size, numTimedSteps);
+				cout << std::setw(4) << size << "x" << std::left << std::setw(4) << size << std::right
+					<< std::setw(11) << LayoutName(type)
+					<< std::setw(13) << (interleaved ? "interleaved" : "separate")
+					<< std::fixed << std::setprecision(2)
+					<< std::setw(9) << 100 * l1MissRate << "%"
+					<< std::setw(9) << 100 * l2MissRate << "%"
+					<< std::setw(10) << nsPerStep << endl;
+			}
+		}
+	}
+	return 0;
+}
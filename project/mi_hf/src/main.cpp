@@ -1,6 +1,8 @@
 #include <GL/glut.h>
 #include <GL/freeglut.h>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <mutex>
 #include <thread>
 #include <iostream>
@@ -11,6 +13,8 @@
 #include "Map.h"
 #include "Game.h"
 #include "Agent.h"
+#include "Visualization.h"
+#include "DeltaStream.h"
 
 using std::cout;
 using std::endl;
@@ -47,8 +51,23 @@ volatile int currentIteration = 0;
 volatile int teachingIterationCount = numIterations;
 
 // The history of reward improvements over a teaching session.
+// Sized when a session starts, and the first currentIteration items are final,
+// so the display only locks mtx to read the counts.
 std::vector<float> rewardHistory;
-std::vector<float> rewardHistoryLowpass;
+std::vector<float> rewardHistoryLowpass; // the first numFiltered items are final
+size_t numFiltered = 0;
+StreamingLowPass rewardFilter; // used by the teaching thread only
+// Summaries of the histories, so that the graph is drawn with a few points
+// per pixel at any length. Used by the display only.
+MinMaxPyramid rewardPyramid;
+MinMaxPyramid lowpassPyramid;
+// The episodes shown on the graph, all of them unless zoomed in.
+bool graphZoomed = false;
+double graphFirst = 0;
+double graphLast = 0;
+const double minGraphSpan = 10;
+size_t graphNumItems = 0; // the episodes known to the display
+int graphDragX = -1; // where the graph is being dragged from, or -1
 
 // The core of the whole game environment.
 Map map(2, 2);
@@ -59,9 +78,12 @@ Agent agent;
 std::thread teachThread;
 std::mutex mtx;
 volatile bool runTeach = true;
-volatile bool finished = false;
-std::unique_ptr<volatile float[]> Q_values;
-volatile float Q_min = -1, Q_max = 1.0;
+std::atomic<bool> finished(false);
+// The values of the states for the color coding of the map. The teaching
+// thread streams the changed ones, and the display patches its own copy.
+DeltaStream valueStream;
+std::vector<float> displayValues;
+float displayMin = 0, displayMax = 1;
 
 /// Computes the color coding for utility values.
 /// Maps utilities on a smooth scale from blue to red.
@@ -91,27 +113,6 @@ void UtilityToColor(float utility, float min, float max, float& r, float& g, flo
 }
 
 
-void RefreshQvalues() {
-	float minq = 0;
-	float maxq = 1;
-	for (size_t x = 0; x < map.GetWidth(); x++) {
-		for (size_t y = 0; y < map.GetHeight(); y++) {
-			float value;
-			if (QvsN) {
-				value = agent.GetQMax(x, y);
-			}
-			else {
-				value = agent.GetNSum(x, y);
-			}
-			minq = std::min(value, minq);
-			maxq = std::max(value, maxq);
-			Q_values[x + y*map.GetWidth()] = value;
-		}
-	}
-	Q_min = minq;
-	Q_max = maxq;
-}
-
 /// Performs a teaching session of the agent.
 /// Teaches the agent by playing a given number of episodes.
 /// Puts the results in rewardHistory.
@@ -119,21 +120,11 @@ void TeachAgent() {
 	cout << "teaching started..." << endl;
 
 	// initalization
-	Q_max = 1;
-	Q_min = 0;
-
 	agent.Reset();
 	game.SetMap(&map);
 	agent.SetGame(&game);
-
-	mtx.lock();
-	rewardHistory.clear();
-
-	teachingIterationCount = numIterations;
-	currentIteration = 0;
-
-	rewardHistory.resize(teachingIterationCount);
-	mtx.unlock();
+	valueStream.RequestResync();
+	valueStream.Flush(agent, QvsN);
 
 	// teaching cycle
 	while (currentIteration < teachingIterationCount && runTeach) {
@@ -141,24 +132,42 @@ void TeachAgent() {
 		game.NewGame();
 		agent.StartEpisode();
 		while (!game.Ended() && runTeach) {
+			// the step changes the current state, and the next one if the game ends
+			valueStream.MarkDirty(game.GetCurrentCell());
 			agent.Step();
+			if (game.Ended()) {
+				valueStream.MarkDirty(game.GetCurrentCell());
+			}
 			if (slowMotion) {
-				RefreshQvalues();
+				valueStream.Flush(agent, QvsN);
 				std::this_thread::sleep_for(std::chrono::milliseconds(1000));
 			}
 		}
 		float reward = agent.EndEpisode();
 
-		// update results after each episode
-		rewardHistory[currentIteration] = reward;
+		// filter the reward once, as soon as enough later rewards are known
+		float filtered;
+		bool isFinal = rewardFilter.Push(reward, filtered);
 
-		RefreshQvalues();
+		valueStream.Flush(agent, QvsN);
 
-		// iteration finished
-		currentIteration++;
+		// update results after each episode
+		{
+			std::lock_guard<std::mutex> lk(mtx);
+			rewardHistory[currentIteration] = reward;
+			if (isFinal) {
+				rewardHistoryLowpass[numFiltered++] = filtered;
+			}
+			// iteration finished
+			currentIteration++;
+		}
 		//cout << "iteration " << currentIteration << " finished: r = " << reward << endl;
 	}
 
+	// a snapshot may be due, and wait for room in the ring
+	while (!valueStream.Flush(agent, QvsN) && runTeach) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
 	finished = true;
 	cout << "teaching finished!" << endl << endl;;
 }
@@ -185,8 +194,10 @@ void DrawMap() {
 	float offx = pixelPerField / 2;
 	float offy = pixelPerField / 2;
 
-	float min = Q_min;
-	float max = Q_max;
+	// patch the states changed since the last frame
+	valueStream.Update(displayValues.data(), displayMin, displayMax);
+	const float min = displayMin;
+	const float max = displayMax;
 
 	// draw fields and frames
 	for (int x = 0; x < map.GetWidth(); x++) {
@@ -197,7 +208,7 @@ void DrawMap() {
 
 			// frame with color coding
 			float r, g, b;
-			UtilityToColor(Q_values[x + y*map.GetWidth()], min, max, r, g, b);
+			UtilityToColor(displayValues[x + y*map.GetWidth()], min, max, r, g, b);
 			glColor3f(r, g, b);
 			DrawQuad(cx, cy, pixelPerField, pixelPerField);
 
@@ -241,7 +252,7 @@ void DrawMap() {
 				glColor3f(0.0f, 0.0f, 0.0f);
 				std::stringstream ss;
 				ss << std::setprecision(2);
-				ss << Q_values[x + y*map.GetWidth()];
+				ss << displayValues[x + y*map.GetWidth()];
 				std::string s = ss.str();
 				std::unique_ptr<unsigned char[]> buffer(new unsigned char[s.size() + 1]);
 				for (size_t i = 0; i < s.size(); i++) {
@@ -262,6 +273,9 @@ void DrawMap() {
 }
 
 /// Draws the graph which shows the improvement over iterations.
+/// Each pixel column shows the range of the raw rewards and the means of
+/// the filtered ones in its episodes, so the number of points only depends on
+/// the width of the screen.
 void DrawGraph() {
 
 	glColor3f(1, 1, 1);
@@ -272,81 +286,118 @@ void DrawGraph() {
 	glVertex2f(0, screenHeight);
 	glEnd();
 
-	std::lock_guard<std::mutex> lk(mtx);
-	size_t numItems = currentIteration + 1;
-	if (rewardHistory.size() == 0) {
-		numItems = 0;
+	size_t numItems;
+	size_t numFinal;
+	{
+		std::lock_guard<std::mutex> lk(mtx);
+		numItems = currentIteration;
+		numFinal = numFiltered;
 	}
 
+	// summarize the episodes finished since the last frame
+	rewardPyramid.Update(numItems);
+	lowpassPyramid.Update(numFinal);
+	graphNumItems = numItems;
+
 	if (numItems == 0)
 		return;
 
-	float minElement;
-	float maxElement;
-	minElement = rewardHistory[0];
-	maxElement = rewardHistory[0];
-
-	for (size_t i = 0; i < numItems; i++) {
-		float value = rewardHistory[i];
-		if (value < minElement)
-			minElement = value;
-		if (value > maxElement)
-			maxElement = value;
+	// the episodes to show
+	size_t first = 0;
+	size_t last = numItems;
+	if (graphZoomed) {
+		first = (size_t)graphFirst;
+		last = std::min(numItems, (size_t)std::ceil(graphLast));
 	}
+	const size_t numShown = last - first;
+	const size_t numPixels = std::max(1, screenWidth);
+
+	MinMaxPyramid::Summary range = rewardPyramid.Query(first, last);
+	float minElement = range.min;
+	float maxElement = range.max > range.min ? range.max : range.min + 1;
+	auto ToScreenY = [&](float value) {
+		return screenHeight - (screenHeight*(1 - divison) / (maxElement - minElement) * (value - minElement));
+	};
 
-	// draw raw line
+	// draw raw line, the lowest and the highest reward of each column
 	if (filter) {
-		glBegin(GL_LINE_STRIP);
+		const size_t numColumns = std::min(numPixels, numShown);
 		glLineWidth(1.0f);
 		glColor3f(0, 0, 1);
-		for (size_t i = 0; i < numItems; i++) {
-			float value = rewardHistory[i];
-			float x = i*(screenWidth / (float)numItems);
-			++i;
-			glVertex2f(x, screenHeight - (screenHeight*(1 - divison) / (maxElement - minElement) * (value - minElement)));
+		glBegin(GL_LINE_STRIP);
+		bool lowFirst = true;
+		for (size_t c = 0; c < numColumns; c++) {
+			size_t begin = first + numShown * c / numColumns;
+			size_t end = first + numShown * (c + 1) / numColumns;
+			MinMaxPyramid::Summary column = rewardPyramid.Query(begin, end);
+			float x = c*(screenWidth / (float)numColumns);
+			// continue from the end the previous column stopped at
+			glVertex2f(x, ToScreenY(lowFirst ? column.min : column.max));
+			glVertex2f(x, ToScreenY(lowFirst ? column.max : column.min));
+			lowFirst = !lowFirst;
 		}
 		glEnd();
 	}
 
-	// draw filtered line
+	// the latest rewards are filtered as if the history ended with them
+	float tail[lowPassRadius];
+	SincLowPass(rewardHistory.data(), numItems, numFinal, numItems, tail);
+
+	// draw filtered line, the mean of two columns per pixel
+	const size_t numColumns = std::min(2 * numPixels, numShown);
+	glLineWidth(5.0f);
 	glColor3f(1, 0, 0);
 	glBegin(GL_LINE_STRIP);
-	glLineWidth(5.0f);
-	for (size_t i = 0; i < rewardHistoryLowpass.size(); i++) {
-		float x = i*(screenWidth / (float)numItems);
-		glVertex2f(x, screenHeight - (screenHeight*(1 - divison) / (maxElement - minElement) * (rewardHistoryLowpass[i] - minElement)));
+	for (size_t c = 0; c < numColumns; c++) {
+		size_t begin = first + numShown * c / numColumns;
+		size_t end = first + numShown * (c + 1) / numColumns;
+		MinMaxPyramid::Summary column = lowpassPyramid.Query(begin, std::min(end, numFinal));
+		for (size_t i = std::max(begin, numFinal); i < end; i++) {
+			column.Add(tail[i - numFinal]);
+		}
+		float x = c*(screenWidth / (float)numColumns);
+		glVertex2f(x, ToScreenY(column.GetMean()));
 	}
 	glEnd();
+	glLineWidth(1.0f);
+}
 
-	// recaulculate filtered line
-	static size_t lastRecalcSize = 0;
-	if (numItems % 20 || (numItems == teachingIterationCount && lastRecalcSize != teachingIterationCount)) {
-		lastRecalcSize = numItems;
-		rewardHistoryLowpass.resize(numItems);
-		intptr_t size = (intptr_t)numItems;
-		for (intptr_t i = 0; i < numItems; i++) {
-			float x = i*(screenWidth / (float)numItems);
-			glColor3f(1, 0, 0);
-
-			// sinc filter with a main bump of -4..4
-			constexpr float spread = 1 / 4.0f;
-			constexpr float pi_rec = 1 / 3.14159265f;
-			float y = rewardHistory[i] * spread * pi_rec;
-			float wt = spread * pi_rec;
-			for (intptr_t filter = 1; filter < 30; filter++) {
-				intptr_t sample1 = i + filter;
-				intptr_t sample2 = i - filter;
-				sample1 = std::max(0, std::min(size - 1, sample1));
-				sample2 = std::max(0, std::min(size - 1, sample2));
-				float w = (sin(filter*spread) / (filter*spread)) * spread * pi_rec;
-				wt += w * 2;
-				y += (rewardHistory[sample1] + rewardHistory[sample2]) * w;
-			}
-			y /= wt;
+/// Keeps the zoomed range of the graph within the history.
+/// Shows the whole history if the range would cover it.
+void ClampGraphRange() {
+	double span = graphLast - graphFirst;
+	if (span >= graphNumItems) {
+		graphZoomed = false;
+		return;
+	}
+	if (graphFirst < 0) {
+		graphFirst = 0;
+		graphLast = span;
+	}
+	if (graphLast > graphNumItems) {
+		graphLast = graphNumItems;
+		graphFirst = graphLast - span;
+	}
+}
 
-			rewardHistoryLowpass[i] = y;
-		}
+/// Zooms the graph in or out, keeping the episode under the cursor in place.
+/// \param x Horizontal position of the cursor.
+/// \param factor The new number of episodes shown over the current one.
+void ZoomGraph(int x, double factor) {
+	if (graphNumItems <= minGraphSpan) {
+		return;
+	}
+	if (!graphZoomed) {
+		graphFirst = 0;
+		graphLast = graphNumItems;
 	}
+	double span = graphLast - graphFirst;
+	double newSpan = std::max(minGraphSpan, span * factor);
+	double center = graphFirst + span * x / std::max(1, screenWidth);
+	graphFirst = center - (center - graphFirst) * newSpan / span;
+	graphLast = graphFirst + newSpan;
+	graphZoomed = true;
+	ClampGraphRange();
 }
 
 /// Draws the user interface on the upper right.
@@ -401,7 +452,9 @@ void DrawUI() {
 		"wasd - modify params\n"
 		"z - step-by-step toggle\n"
 		"h - Q table vs hot path toggle\n"
-		"f - filter toggle\n";
+		"f - filter toggle\n"
+		"mouse wheel, drag - zoom, move graph\n"
+		"g - whole graph\n";
 	glutBitmapString(GLUT_BITMAP_HELVETICA_10, helpText);
 
 }
@@ -413,6 +466,19 @@ void StartTeaching() {
 		teachThread.join();
 	}
 	if (!teachThread.joinable()) {
+		// the display reads the history without locking, so it is only
+		// resized while there is no teaching thread
+		teachingIterationCount = numIterations;
+		currentIteration = 0;
+		rewardHistory.assign(teachingIterationCount, 0.0f);
+		rewardHistoryLowpass.assign(teachingIterationCount, 0.0f);
+		numFiltered = 0;
+		rewardFilter.Reset();
+		rewardPyramid.Attach(rewardHistory.data());
+		lowpassPyramid.Attach(rewardHistoryLowpass.data());
+		graphNumItems = 0;
+		graphZoomed = false;
+
 		runTeach = true;
 		finished = false;
 		teachThread = std::thread(TeachAgent);
@@ -442,11 +508,11 @@ void CreateMap(int width, int height, int walls, int mines) {
 	map(map.GetWidth() - 1, map.GetHeight() - 1).type = Map::Field::FINISH;
 	map(0, 0).type = Map::Field::FREE;
 
-	// create table for Q values
-	Q_values.reset(new volatile float[map.GetWidth()*map.GetHeight()]);
-	for (size_t i = 0; i < map.GetWidth()*map.GetHeight(); ++i) {
-		Q_values[i] = 0;
-	}
+	// no values until the next teaching
+	valueStream.Reset(map.GetWidth(), map.GetHeight());
+	displayValues.assign((size_t)map.GetWidth() * map.GetHeight(), 0.0f);
+	displayMin = 0;
+	displayMax = 1;
 }
 
 /// Initializes OpenGL and stuff like that.
@@ -495,14 +561,25 @@ void onKeyboard(unsigned char key, int x, int y) {
 	// show hot path
 	if (key == 'h') {
 		QvsN = !QvsN;
+		valueStream.RequestResync();
 		if (finished) {
-			RefreshQvalues();
+			// no teaching thread to flush, take over its side of the stream,
+			// and drain the ring to make room
+			if (teachThread.joinable()) {
+				teachThread.join();
+			}
+			valueStream.Update(displayValues.data(), displayMin, displayMax);
+			valueStream.Flush(agent, QvsN);
 		}
 	}
 	// toggle low-pass filtering only
 	if (key == 'f') {
 		filter = !filter;
 	}
+	// show the whole graph
+	if (key == 'g') {
+		graphZoomed = false;
+	}
 
 	// parameters menu
 	// up
@@ -546,13 +623,31 @@ void onKeyboardUp(unsigned char key, int x, int y) {
 }
 
 void onMouse(int button, int state, int x, int y) {
+	bool onGraph = y > screenHeight*divison;
+	// the wheel is reported as buttons 3 and 4
+	if (onGraph && button == 3 && state == GLUT_DOWN) {
+		ZoomGraph(x, 0.8);
+	}
+	if (onGraph && button == 4 && state == GLUT_DOWN) {
+		ZoomGraph(x, 1.25);
+	}
+	if (button == GLUT_LEFT_BUTTON) {
+		graphDragX = onGraph && state == GLUT_DOWN ? x : -1;
+	}
 	if (button == GLUT_LEFT_BUTTON && state == GLUT_DOWN)
 		glutPostRedisplay();
 }
 
 void onMouseMotion(int x, int y)
 {
-
+	// move the zoomed graph along with the cursor
+	if (graphDragX >= 0 && graphZoomed) {
+		double shift = (graphLast - graphFirst) * (graphDragX - x) / std::max(1, screenWidth);
+		graphFirst += shift;
+		graphLast += shift;
+		ClampGraphRange();
+	}
+	graphDragX = graphDragX >= 0 ? x : -1;
 }
 
 void onIdle() {
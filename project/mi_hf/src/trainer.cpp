@@ -0,0 +1,1018 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Map.h"
+#include "Game.h"
+#include "Agent.h"
+#include "GameBatch.h"
+#include "ParallelTeaching.h"
+#include "Solver.h"
+#include "CheckpointScheduler.h"
+#include "MapFile.h"
+#include "MapGenerator.h"
+#include "Philox.h"
+#include "FixedSize.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+/// Parameters of a headless teaching session.
+struct TrainerOptions {
+	int mapWidth = 10;
+	int mapHeight = 10;
+	int numWalls = 5;
+	int numMines = 5;
+	int numIterations = 10000;
+	size_t seed = Seed();
+	std::string mode = "serial";
+	int batchSize = 1024;
+	int numThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+	int mergeInterval = 100;
+	float tolerance = 1e-6f;
+	int planningSteps = 0;
+	TableLayout::eType layout = TableLayout::ROW_MAJOR;
+	bool interleaved = false;
+	bool quantized = false;
+	bool sparse = false;
+	std::string loadPath; ///< Checkpoint to continue from in serial mode.
+	std::string savePath; ///< Checkpoint to write after serial mode.
+	std::string checkpointPath; ///< Checkpoint to write periodically in serial mode.
+	int checkpointEpisodes = 0;
+	double checkpointSeconds = 0;
+	std::string mapPath; ///< Map file to load instead of generating one.
+	std::string saveMapPath; ///< Map file to write the map to.
+	std::string libraryPath; ///< Map library to load from, or to write in library mode.
+	int libraryIndex = 0; ///< Map of the library to load.
+	int numMaps = 100; ///< Number of maps to generate in library and generate mode.
+	std::string generator = "legacy"; ///< Map::Generate, or a layout of MapGenerator.
+	MapGenerator::eSolvability solvability = MapGenerator::REPAIR;
+	RandomSource::eEngine randomEngine = RandomSource::MT19937;
+	bool fixedSize = true; ///< Use the compile-time sized game and agent in serial mode, if there is one.
+};
+
+/// Results of a headless teaching session.
+struct TrainerResult {
+	std::vector<float> rewardHistory;
+	long long numSteps = 0;
+	double seconds = 0;
+	size_t tableBytes = 0; ///< Memory of the Q and N tables, 0 if unknown.
+};
+
+
+void PrintUsage(const char* program) {
+	cout << "usage: " << program << " [options]" << endl
+		<< "  --width N       map width (default 10)" << endl
+		<< "  --height N      map height (default 10)" << endl
+		<< "  --walls N       number of walls (default 5)" << endl
+		<< "  --mines N       number of mines (default 5)" << endl
+		<< "  --iterations N  number of episodes (default 10000)" << endl
+		<< "  --seed N        seed of every random engine (default: time based)" << endl
+		<< "  --mode M        serial: Q learning with a single game (default)" << endl
+		<< "                  batch: random rollouts on a GameBatch" << endl
+		<< "                  hogwild: Q learning with many threads on shared tables" << endl
+		<< "                  average: Q learning with many threads on private tables," << endl
+		<< "                           merged periodically" << endl
+		<< "                  solve: value iteration for the optimal Q table" << endl
+		<< "                  quantized: serial mode with full and 16 bit tables side by side" << endl
+		<< "                  library: generate a map library, and compare loading to generating" << endl
+		<< "                  generate: time the map generator against Map::Generate" << endl
+		<< "  --batch N       number of games in batch mode (default 1024)" << endl
+		<< "  --threads N     number of threads in parallel modes (default: all cores)" << endl
+		<< "  --interval N    episodes per thread between merges in average mode (default 100)" << endl
+		<< "  --tolerance X   convergence tolerance in solve mode (default 1e-6)" << endl
+		<< "  --planning N    prioritized sweeping backups per step in serial and average mode (default 0)" << endl
+		<< "  --layout L      order of the Q and N tables: row, tiled or morton (default row)" << endl
+		<< "  --interleave B  1 to store Q and N of a state in one record (default 0)" << endl
+		<< "  --quantize B    1 to store Q and N in 16 bit precision (default 0)" << endl
+		<< "  --sparse B      1 to store only the visited states in a hash table, and not" << endl
+		<< "                  compile the map, so memory grows with the visited states (default 0)" << endl
+		<< "  --load FILE     continue from a checkpoint in serial mode" << endl
+		<< "  --save FILE     write a checkpoint after serial mode" << endl
+		<< "  --checkpoint FILE  write checkpoints in the background during serial mode" << endl
+		<< "  --checkpoint-every N    episodes between checkpoints (default: 10% of the iterations)" << endl
+		<< "  --checkpoint-seconds X  wall time between checkpoints (default: none)" << endl
+		<< "  --map FILE      load the map from a file instead of generating it" << endl
+		<< "  --save-map FILE write the map to a file" << endl
+		<< "  --library FILE  map library to load the map from, or to write in library mode" << endl
+		<< "  --library-index N  map of the library to load (default 0)" << endl
+		<< "  --maps N        number of maps in library and generate mode, seeds from --seed on (default 100)" << endl
+		<< "  --generator G   legacy: Map::Generate (default)" << endl
+		<< "                  scatter, maze, clustered, corridor or uniform: MapGenerator layouts," << endl
+		<< "                  uniform is generated with --threads threads" << endl
+		<< "  --solvable S    unsolvable generated maps: any, repair (default) or reject" << endl
+		<< "  --rng R         random engine of the game and the agent in serial mode:" << endl
+		<< "                  mt (default), xoshiro or pcg" << endl
+		<< "  --fixed B       0 to never use the game and agent compiled for the map size" << endl
+		<< "                  in serial mode, 10x10 and 64x64 (default 1)" << endl;
+}
+
+/// Parses the command line into options.
+/// \return False if the command line is malformed or help was requested.
+bool ParseArguments(int argc, char** argv, TrainerOptions& options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h") {
+			return false;
+		}
+		if (i + 1 >= argc) {
+			cerr << "missing value for " << arg << endl;
+			return false;
+		}
+		const char* value = argv[++i];
+		if (arg == "--width") {
+			options.mapWidth = std::atoi(value);
+		}
+		else if (arg == "--height") {
+			options.mapHeight = std::atoi(value);
+		}
+		else if (arg == "--walls") {
+			options.numWalls = std::atoi(value);
+		}
+		else if (arg == "--mines") {
+			options.numMines = std::atoi(value);
+		}
+		else if (arg == "--iterations") {
+			options.numIterations = std::atoi(value);
+		}
+		else if (arg == "--seed") {
+			options.seed = (size_t)std::strtoull(value, nullptr, 10);
+		}
+		else if (arg == "--mode") {
+			options.mode = value;
+		}
+		else if (arg == "--batch") {
+			options.batchSize = std::atoi(value);
+		}
+		else if (arg == "--threads") {
+			options.numThreads = std::atoi(value);
+		}
+		else if (arg == "--interval") {
+			options.mergeInterval = std::atoi(value);
+		}
+		else if (arg == "--tolerance") {
+			options.tolerance = (float)std::atof(value);
+		}
+		else if (arg == "--planning") {
+			options.planningSteps = std::atoi(value);
+		}
+		else if (arg == "--interleave") {
+			options.interleaved = std::atoi(value) != 0;
+		}
+		else if (arg == "--quantize") {
+			options.quantized = std::atoi(value) != 0;
+		}
+		else if (arg == "--sparse") {
+			options.sparse = std::atoi(value) != 0;
+		}
+		else if (arg == "--load") {
+			options.loadPath = value;
+		}
+		else if (arg == "--save") {
+			options.savePath = value;
+		}
+		else if (arg == "--checkpoint") {
+			options.checkpointPath = value;
+		}
+		else if (arg == "--checkpoint-every") {
+			options.checkpointEpisodes = std::atoi(value);
+		}
+		else if (arg == "--checkpoint-seconds") {
+			options.checkpointSeconds = std::atof(value);
+		}
+		else if (arg == "--map") {
+			options.mapPath = value;
+		}
+		else if (arg == "--save-map") {
+			options.saveMapPath = value;
+		}
+		else if (arg == "--library") {
+			options.libraryPath = value;
+		}
+		else if (arg == "--library-index") {
+			options.libraryIndex = std::atoi(value);
+		}
+		else if (arg == "--maps") {
+			options.numMaps = std::atoi(value);
+		}
+		else if (arg == "--generator") {
+			options.generator = value;
+			if (options.generator != "legacy" && options.generator != "scatter" && options.generator != "maze"
+				&& options.generator != "clustered" && options.generator != "corridor" && options.generator != "uniform")
+			{
+				cerr << "unknown generator " << options.generator << endl;
+				return false;
+			}
+		}
+		else if (arg == "--solvable") {
+			std::string solvability = value;
+			if (solvability == "any") {
+				options.solvability = MapGenerator::ANY;
+			}
+			else if (solvability == "repair") {
+				options.solvability = MapGenerator::REPAIR;
+			}
+			else if (solvability == "reject") {
+				options.solvability = MapGenerator::REJECT;
+			}
+			else {
+				cerr << "unknown solvability " << solvability << endl;
+				return false;
+			}
+		}
+		else if (arg == "--rng") {
+			std::string engine = value;
+			if (engine == "mt") {
+				options.randomEngine = RandomSource::MT19937;
+			}
+			else if (engine == "xoshiro") {
+				options.randomEngine = RandomSource::XOSHIRO256;
+			}
+			else if (engine == "pcg") {
+				options.randomEngine = RandomSource::PCG32;
+			}
+			else {
+				cerr << "unknown random engine " << engine << endl;
+				return false;
+			}
+		}
+		else if (arg == "--fixed") {
+			options.fixedSize = std::atoi(value) != 0;
+		}
+		else if (arg == "--layout") {
+			std::string layout = value;
+			if (layout == "row") {
+				options.layout = TableLayout::ROW_MAJOR;
+			}
+			else if (layout == "tiled") {
+				options.layout = TableLayout::TILED;
+			}
+			else if (layout == "morton") {
+				options.layout = TableLayout::MORTON;
+			}
+			else {
+				cerr << "unknown layout " << layout << endl;
+				return false;
+			}
+		}
+		else {
+			cerr << "unknown option " << arg << endl;
+			return false;
+		}
+	}
+	return options.numIterations > 0 && options.batchSize > 0 && options.numThreads > 0
+		&& options.mergeInterval > 0;
+}
+
+/// Configure a MapGenerator according to the parameters specified.
+void SetupGenerator(MapGenerator& generator, const TrainerOptions& options) {
+	if (options.generator == "maze") {
+		generator.SetLayout(MapGenerator::MAZE);
+	}
+	else if (options.generator == "clustered") {
+		generator.SetLayout(MapGenerator::CLUSTERED);
+	}
+	else if (options.generator == "corridor") {
+		generator.SetLayout(MapGenerator::CORRIDOR);
+	}
+	else if (options.generator == "uniform") {
+		generator.SetLayout(MapGenerator::UNIFORM);
+	}
+	else {
+		generator.SetLayout(MapGenerator::SCATTER);
+	}
+	generator.SetSolvability(options.solvability);
+	generator.SetThreads(options.numThreads);
+}
+
+/// Generate a map according to the parameters specified.
+/// Also adds a start and a finish, same as the interactive application.
+/// \param info [output] Metadata of the map.
+void GenerateMap(Map& map, const TrainerOptions& options, size_t seed, MapInfo& info) {
+	map.Resize(std::max(2, options.mapWidth), std::max(2, options.mapHeight));
+	if (options.generator == "legacy") {
+		map.SetSeed(seed);
+		map.Generate(options.numWalls, options.numMines);
+		map(map.GetWidth() - 1, map.GetHeight() - 1).type = Map::Field::FINISH;
+		map(0, 0).type = Map::Field::FREE;
+	}
+	else {
+		MapGenerator generator;
+		SetupGenerator(generator, options);
+		generator.SetSeed(seed);
+		generator.Generate(map, options.numWalls, options.numMines);
+	}
+
+	info.startX = 0;
+	info.startY = 0;
+	info.finishX = map.GetWidth() - 1;
+	info.finishY = map.GetHeight() - 1;
+	info.numWalls = options.numWalls;
+	info.numMines = options.numMines;
+	info.seed = seed;
+}
+
+/// Create a map according to the parameters specified: load it from a map
+/// file or library, or generate it. Writes it to a file if requested.
+/// \param info [output] Metadata of the map.
+/// \return False if the map can't be loaded or saved.
+bool CreateMap(Map& map, const TrainerOptions& options, MapInfo& info) {
+	if (!options.mapPath.empty()) {
+		if (!LoadMap(map, options.mapPath, &info)) {
+			cerr << "could not load map " << options.mapPath << endl;
+			return false;
+		}
+	}
+	else if (!options.libraryPath.empty() && options.mode != "library") {
+		MapLibrary library;
+		if (!library.Open(options.libraryPath) || !library.Load(options.libraryIndex, map, &info)) {
+			cerr << "could not load map " << options.libraryIndex << " of " << options.libraryPath << endl;
+			return false;
+		}
+	}
+	else {
+		GenerateMap(map, options, options.seed, info);
+	}
+	if (!options.saveMapPath.empty() && !SaveMap(map, info, options.saveMapPath)) {
+		cerr << "could not save map " << options.saveMapPath << endl;
+		return false;
+	}
+	return true;
+}
+
+/// Prints how long the learner stalled for each background checkpoint.
+void PrintCheckpoints(const std::vector<CheckpointScheduler::Record>& records, double seconds) {
+	double totalStall = 0, maxStall = 0;
+	cout << "checkpoint    episode   stall [ms]   write [ms]" << endl;
+	for (size_t i = 0; i < records.size(); ++i) {
+		const auto& record = records[i];
+		totalStall += record.stallSeconds;
+		maxStall = std::max(maxStall, record.stallSeconds);
+		cout << std::setw(10) << i + 1
+			<< std::setw(11) << record.episode
+			<< std::fixed << std::setprecision(3)
+			<< std::setw(13) << 1000 * record.stallSeconds;
+		if (record.written) {
+			cout << std::setw(13) << 1000 * record.writeSeconds << endl;
+		}
+		else {
+			cout << std::setw(13) << "skipped" << endl;
+		}
+	}
+	cout << "total stall [ms]:  " << 1000 * totalStall
+		<< " (" << 100 * totalStall / seconds << "% of teaching), max " << 1000 * maxStall << endl;
+}
+
+/// Seeds the game and the agent, and sets them up on the map according to
+/// the options.
+void SetUpAgent(Map& map, const TrainerOptions& options, Game& game, Agent& agent) {
+	game.SetSeed(options.seed + 1);
+	agent.SetSeed(options.seed + 2);
+	game.SetRandomEngine(options.randomEngine);
+	agent.SetRandomEngine(options.randomEngine);
+	agent.SetPlanning(options.planningSteps);
+	agent.SetLayout(options.layout);
+	agent.SetInterleaved(options.interleaved);
+	agent.SetQuantized(options.quantized);
+	agent.SetSparse(options.sparse);
+	// the compiled rules would take more memory than the sparse tables save
+	game.SetCompiled(!options.sparse);
+	game.SetMap(&map);
+	agent.SetGame(&game);
+}
+
+/// Performs a teaching session of the agent without any display.
+/// Same as TeachAgent in the interactive application, but counts steps and
+/// measures the elapsed time.
+/// \param game The game to play on, set up on the map.
+/// \param agent The agent to teach, set up according to the options.
+TrainerResult TeachAgent(Map& map, const TrainerOptions& options, Game& game, Agent& agent) {
+	SetUpAgent(map, options, game, agent);
+	if (!options.loadPath.empty()) {
+		auto start = std::chrono::steady_clock::now();
+		bool loaded = agent.LoadCheckpoint(options.loadPath);
+		auto end = std::chrono::steady_clock::now();
+		if (loaded) {
+			cout << "loaded " << options.loadPath << " in "
+				<< std::chrono::duration<double, std::milli>(end - start).count() << " ms" << endl;
+		}
+		else {
+			cerr << "could not load checkpoint " << options.loadPath << ", starting from scratch" << endl;
+		}
+	}
+
+	std::unique_ptr<CheckpointScheduler> scheduler;
+	if (!options.checkpointPath.empty()) {
+		int episodeInterval = options.checkpointEpisodes;
+		if (episodeInterval == 0 && options.checkpointSeconds == 0) {
+			episodeInterval = std::max(1, options.numIterations / 10);
+		}
+		scheduler = std::make_unique<CheckpointScheduler>(options.checkpointPath, episodeInterval, options.checkpointSeconds);
+	}
+
+	TrainerResult result;
+	result.rewardHistory.resize(options.numIterations);
+
+	auto start = std::chrono::steady_clock::now();
+	for (int iteration = 0; iteration < options.numIterations; ++iteration) {
+		game.NewGame();
+		agent.StartEpisode();
+		while (!game.Ended()) {
+			agent.Step();
+			++result.numSteps;
+		}
+		result.rewardHistory[iteration] = agent.EndEpisode();
+		if (scheduler) {
+			scheduler->EndEpisode(agent);
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	result.seconds = std::chrono::duration<double>(end - start).count();
+	result.tableBytes = agent.GetTableMemoryUsage();
+
+	if (scheduler) {
+		scheduler->Flush();
+		PrintCheckpoints(scheduler->GetRecords(), result.seconds);
+	}
+
+	if (!options.savePath.empty()) {
+		auto saveStart = std::chrono::steady_clock::now();
+		bool saved = agent.SaveCheckpoint(options.savePath);
+		auto saveEnd = std::chrono::steady_clock::now();
+		if (saved) {
+			cout << "saved " << options.savePath << " in "
+				<< std::chrono::duration<double, std::milli>(saveEnd - saveStart).count() << " ms" << endl;
+		}
+		else {
+			cerr << "could not save checkpoint " << options.savePath << endl;
+		}
+	}
+
+	return result;
+}
+
+/// Performs a teaching session of the agent on a map of W x H fields, with
+/// the game and agent compiled for that size. Same episodes as TeachAgent.
+template <int W, int H>
+TrainerResult TeachFixedAgent(Map& map, const TrainerOptions& options) {
+	auto model = std::make_unique<FixedModel<W, H>>();
+	auto game = std::make_unique<FixedGame<W, H>>();
+	auto agent = std::make_unique<FixedAgent<W, H>>();
+	model->Build(map);
+	game->SetSeed(options.seed + 1);
+	agent->SetSeed(options.seed + 2);
+	game->SetRandomEngine(options.randomEngine);
+	agent->SetRandomEngine(options.randomEngine);
+	game->SetModel(model.get());
+	agent->SetGame(game.get());
+
+	TrainerResult result;
+	result.rewardHistory.resize(options.numIterations);
+
+	auto start = std::chrono::steady_clock::now();
+	for (int iteration = 0; iteration < options.numIterations; ++iteration) {
+		game->NewGame();
+		agent->StartEpisode();
+		while (!game->Ended()) {
+			agent->Step();
+			++result.numSteps;
+		}
+		result.rewardHistory[iteration] = agent->EndEpisode();
+	}
+	auto end = std::chrono::steady_clock::now();
+	result.seconds = std::chrono::duration<double>(end - start).count();
+	result.tableBytes = agent->GetTableMemoryUsage();
+	return result;
+}
+
+/// A teaching session specialized for a map size.
+struct FixedSizeTeacher {
+	int width;
+	int height;
+	TrainerResult (*teach)(Map& map, const TrainerOptions& options);
+};
+
+/// The map sizes with a compiled game and agent, the standard benchmark sizes.
+/// Add an entry here to specialize another size.
+const FixedSizeTeacher fixedSizeTeachers[] = {
+	{ 10, 10, &TeachFixedAgent<10, 10> },
+	{ 64, 64, &TeachFixedAgent<64, 64> },
+};
+
+/// Find the specialized teaching session for the map and the options.
+/// \return Null if the size isn't specialized, or an option needs the full
+/// Agent, in which case the dynamic one is used.
+const FixedSizeTeacher* FindFixedSizeTeacher(const Map& map, const TrainerOptions& options) {
+	if (!options.fixedSize || options.planningSteps > 0 || options.layout != TableLayout::ROW_MAJOR
+		|| options.interleaved || options.quantized || options.sparse
+		|| !options.loadPath.empty() || !options.savePath.empty() || !options.checkpointPath.empty())
+	{
+		return nullptr;
+	}
+	for (const auto& teacher : fixedSizeTeachers) {
+		if (teacher.width == map.GetWidth() && teacher.height == map.GetHeight()) {
+			return &teacher;
+		}
+	}
+	return nullptr;
+}
+
+/// Performs a teaching session of the agent without any display.
+/// Uses the game and agent compiled for the map size, if there is one.
+TrainerResult TeachAgent(Map& map, const TrainerOptions& options) {
+	if (auto teacher = FindFixedSizeTeacher(map, options)) {
+		cout << "using the game and agent compiled for " << teacher->width << "x" << teacher->height << endl;
+		return teacher->teach(map, options);
+	}
+	Game game;
+	Agent agent;
+	return TeachAgent(map, options, game, agent);
+}
+
+/// Plays random episodes on a batch of games to measure the raw throughput of
+/// the environment. Finished games are restarted right away, until the
+/// requested number of episodes have been played.
+TrainerResult RolloutBatch(Map& map, const TrainerOptions& options) {
+	size_t size = options.batchSize;
+	GameBatch batch(size, options.seed + 1);
+	batch.SetMap(&map);
+	batch.NewGames();
+
+	std::mt19937 rne((std::mt19937::result_type)(options.seed + 2));
+	std::vector<eAction> actions(size);
+	std::vector<float> rewards(size);
+	std::vector<uint8_t> done(size);
+	std::vector<float> totalRewards(size, 0.0f);
+
+	TrainerResult result;
+	result.rewardHistory.reserve(options.numIterations);
+
+	auto start = std::chrono::steady_clock::now();
+	while (result.rewardHistory.size() < (size_t)options.numIterations) {
+		for (auto& action : actions) {
+			action = (eAction)(rne() >> 30);
+		}
+		batch.PerformActions(actions.data(), rewards.data(), done.data());
+		result.numSteps += size;
+		for (size_t i = 0; i < size; ++i) {
+			totalRewards[i] += rewards[i];
+			if (done[i]) {
+				if (result.rewardHistory.size() < (size_t)options.numIterations) {
+					result.rewardHistory.push_back(totalRewards[i]);
+				}
+				totalRewards[i] = 0.0f;
+				batch.NewGame(i);
+			}
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	result.seconds = std::chrono::duration<double>(end - start).count();
+
+	return result;
+}
+
+/// Teaches the agent with an increasing number of threads on shared tables,
+/// and prints how close the speedup gets to linear. Each round plays the same
+/// number of episodes. Returns the result of the round with the most threads.
+TrainerResult TeachHogwildScaling(Map& map, const TrainerOptions& options) {
+	Game game;
+	Agent agent;
+	agent.SetLayout(options.layout);
+	agent.SetInterleaved(options.interleaved);
+	game.SetMap(&map);
+	agent.SetGame(&game);
+
+	std::vector<int> threadCounts;
+	for (int numThreads = 1; numThreads < options.numThreads; numThreads *= 2) {
+		threadCounts.push_back(numThreads);
+	}
+	threadCounts.push_back(options.numThreads);
+
+	ParallelTeachingResult parallelResult;
+	double baseStepsPerSec = 0;
+	cout << "threads   time [s]      steps/sec   speedup   efficiency" << endl;
+	for (int numThreads : threadCounts) {
+		parallelResult = TeachHogwild(agent, map, numThreads, options.numIterations, options.seed);
+		double stepsPerSec = parallelResult.numSteps / parallelResult.seconds;
+		if (numThreads == 1) {
+			baseStepsPerSec = stepsPerSec;
+		}
+		double speedup = stepsPerSec / baseStepsPerSec;
+		cout << std::setw(7) << numThreads
+			<< std::fixed << std::setprecision(3)
+			<< std::setw(11) << parallelResult.seconds
+			<< std::setprecision(0) << std::setw(15) << stepsPerSec
+			<< std::setprecision(2) << std::setw(10) << speedup
+			<< std::setw(12) << speedup / numThreads << endl;
+	}
+
+	TrainerResult result;
+	result.rewardHistory = std::move(parallelResult.rewardHistory);
+	result.numSteps = parallelResult.numSteps;
+	result.seconds = parallelResult.seconds;
+	return result;
+}
+
+/// Teaches the agent with private tables per thread and periodic merges, and
+/// prints the progress after the merges.
+TrainerResult TeachModelAveraging(Map& map, const TrainerOptions& options) {
+	Game game;
+	Agent agent;
+	agent.SetPlanning(options.planningSteps);
+	agent.SetLayout(options.layout);
+	agent.SetInterleaved(options.interleaved);
+	agent.SetQuantized(options.quantized);
+	agent.SetSparse(options.sparse);
+	game.SetMap(&map);
+	agent.SetGame(&game);
+
+	ParallelTeachingResult parallelResult = TeachModelAveraging(
+		agent, map, options.numThreads, options.numIterations, options.mergeInterval, options.seed);
+
+	// print about 20 rounds, always including the last one
+	const auto& rounds = parallelResult.rounds;
+	size_t printStride = std::max<size_t>(1, rounds.size() / 20);
+	cout << "  round   episodes   time [s]   episodes/sec   max dQ   mean reward" << endl;
+	for (size_t i = 0; i < rounds.size(); ++i) {
+		if (i % printStride != 0 && i + 1 != rounds.size()) {
+			continue;
+		}
+		const auto& round = rounds[i];
+		cout << std::setw(7) << i + 1
+			<< std::setw(11) << round.numEpisodes
+			<< std::fixed << std::setprecision(3)
+			<< std::setw(11) << round.seconds
+			<< std::setprecision(0) << std::setw(15) << round.numEpisodes / round.seconds
+			<< std::setprecision(4) << std::setw(9) << round.maxDelta
+			<< std::setprecision(3) << std::setw(14) << round.meanReward << endl;
+	}
+
+	TrainerResult result;
+	result.rewardHistory = std::move(parallelResult.rewardHistory);
+	result.numSteps = parallelResult.numSteps;
+	result.seconds = parallelResult.seconds;
+	return result;
+}
+
+/// Teaches an agent with full precision and one with 16 bit tables with the
+/// same seeds, and prints their times and rewards, and how far the values of
+/// the states each of them visited are from the optimum. As the agents take
+/// different paths once a rounded Q value changes a greedy choice, the
+/// precision of the tables is then compared on the same experience: the steps
+/// of another full precision session are learned by a 16 bit table as well.
+/// Returns the result of the quantized agent.
+TrainerResult TeachQuantizedComparison(Map& map, const TrainerOptions& options) {
+	TrainerOptions fullOptions = options;
+	fullOptions.quantized = false;
+	TrainerOptions quantizedOptions = options;
+	quantizedOptions.quantized = true;
+
+	Game fullGame, quantizedGame;
+	Agent fullAgent, quantizedAgent;
+	TrainerResult fullResult = TeachAgent(map, fullOptions, fullGame, fullAgent);
+	TrainerResult quantizedResult = TeachAgent(map, quantizedOptions, quantizedGame, quantizedAgent);
+
+	// replay the steps of the full precision agent into a 16 bit table, the
+	// leader takes the same steps as fullAgent did
+	Game replayGame;
+	Agent leader, follower;
+	SetUpAgent(map, fullOptions, replayGame, leader);
+	follower.CopySettings(leader);
+	follower.SetQuantized(true);
+	follower.SetGame(&replayGame);
+	for (int iteration = 0; iteration < options.numIterations; ++iteration) {
+		replayGame.NewGame();
+		leader.StartEpisode();
+		while (!replayGame.Ended()) {
+			int x = replayGame.GetCurrentX();
+			int y = replayGame.GetCurrentY();
+			eAction action = leader.SelectNextStep(x, y);
+			bool isOver = replayGame.PerformAction(action);
+			float reward = replayGame.GetCurrentReward();
+			int newx = replayGame.GetCurrentX();
+			int newy = replayGame.GetCurrentY();
+			leader.Learn(x, y, action, newx, newy, reward, isOver);
+			follower.Learn(x, y, action, newx, newy, reward, isOver);
+		}
+		leader.EndEpisode();
+	}
+
+	Solver solver;
+	solver.Solve(map, options.tolerance, options.numThreads);
+
+	// the values of the states each agent visited itself
+	auto meanValueError = [&](const Agent& agent) {
+		double sum = 0;
+		long long numStates = 0;
+		for (int y = 0; y < map.GetHeight(); ++y) {
+			for (int x = 0; x < map.GetWidth(); ++x) {
+				if (agent.GetNSum(x, y) > 0) {
+					sum += std::abs(agent.GetQMax(x, y) - solver.GetQMax(x, y));
+					++numStates;
+				}
+			}
+		}
+		return sum / std::max(1LL, numStates);
+	};
+
+	// the Q values of the replayed actions, both tables saw the same updates
+	double sumError = 0, maxError = 0;
+	double leaderOptimumError = 0, followerOptimumError = 0;
+	long long numEntries = 0;
+	for (int y = 0; y < map.GetHeight(); ++y) {
+		for (int x = 0; x < map.GetWidth(); ++x) {
+			for (int a = 0; a < 4; ++a) {
+				if (leader.GetN(x, y, (eAction)a) == 0) {
+					continue;
+				}
+				float q = leader.GetQ(x, y, (eAction)a);
+				float q16 = follower.GetQ(x, y, (eAction)a);
+				double error = std::abs(q16 - q);
+				sumError += error;
+				maxError = std::max(maxError, error);
+				leaderOptimumError += std::abs(q - solver.GetQ(x, y, (eAction)a));
+				followerOptimumError += std::abs(q16 - solver.GetQ(x, y, (eAction)a));
+				++numEntries;
+			}
+		}
+	}
+	auto meanReward = [](const std::vector<float>& history, size_t first) {
+		double sum = 0;
+		for (size_t i = first; i < history.size(); ++i) {
+			sum += history[i];
+		}
+		return sum / (history.size() - first);
+	};
+	size_t tail = fullResult.rewardHistory.size() - std::max<size_t>(1, fullResult.rewardHistory.size() / 10);
+
+	cout << std::fixed << std::setprecision(3);
+	cout << "                              full      16 bit" << endl;
+	cout << "time [s]:                " << std::setw(10) << fullResult.seconds << std::setw(12) << quantizedResult.seconds << endl;
+	cout << "mean reward:             " << std::setw(10) << meanReward(fullResult.rewardHistory, 0)
+		<< std::setw(12) << meanReward(quantizedResult.rewardHistory, 0) << endl;
+	cout << "mean reward (last 10%):  " << std::setw(10) << meanReward(fullResult.rewardHistory, tail)
+		<< std::setw(12) << meanReward(quantizedResult.rewardHistory, tail) << endl;
+	cout << "mean |V - V*| (visited): " << std::setw(10) << meanValueError(fullAgent)
+		<< std::setw(12) << meanValueError(quantizedAgent) << endl;
+	cout << "on the same experience:" << endl;
+	cout << "mean |Q - Q*| (visited): " << std::setw(10) << leaderOptimumError / std::max(1LL, numEntries)
+		<< std::setw(12) << followerOptimumError / std::max(1LL, numEntries) << endl;
+	cout << std::setprecision(6);
+	cout << "visited Q entries:       " << numEntries << endl;
+	cout << "mean |Q16 - Q|:          " << sumError / std::max(1LL, numEntries) << endl;
+	cout << "max |Q16 - Q|:           " << maxError << endl;
+
+	return quantizedResult;
+}
+
+/// Generates maps with consecutive seeds into a library, then loads all of
+/// them back, and prints how long generating and loading took.
+/// \return False if the library can't be written or read.
+bool BuildMapLibrary(const TrainerOptions& options) {
+	if (options.libraryPath.empty()) {
+		cerr << "library mode needs --library" << endl;
+		return false;
+	}
+	Map map(2, 2);
+	MapInfo info;
+	MapLibraryWriter writer(options.libraryPath);
+	double generateSeconds = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < options.numMaps; ++i) {
+		auto generateStart = std::chrono::steady_clock::now();
+		GenerateMap(map, options, options.seed + i, info);
+		generateSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - generateStart).count();
+		writer.Add(map, info);
+	}
+	if (!writer.Close()) {
+		cerr << "could not write library " << options.libraryPath << endl;
+		return false;
+	}
+	double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	MapLibrary library;
+	if (!library.Open(options.libraryPath)) {
+		cerr << "could not open library " << options.libraryPath << endl;
+		return false;
+	}
+	for (size_t i = 0; i < library.GetCount(); ++i) {
+		if (!library.Load(i, map)) {
+			cerr << "could not load map " << i << " of the library" << endl;
+			return false;
+		}
+	}
+	double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	cout << std::fixed << std::setprecision(3);
+	cout << "maps:              " << library.GetCount() << endl;
+	cout << "generate [ms/map]: " << 1000 * generateSeconds / options.numMaps << endl;
+	cout << "build [s]:         " << buildSeconds << endl;
+	cout << "load [ms/map]:     " << 1000 * loadSeconds / options.numMaps << endl;
+	return true;
+}
+
+/// Check Philox against the known answers of the Random123 library.
+/// \return True if all of them match.
+bool CheckPhilox() {
+	struct KnownAnswer {
+		uint64_t key;
+		Philox::Counter counter;
+		Philox::Counter result;
+	};
+	const KnownAnswer knownAnswers[] = {
+		{ 0x0000000000000000, { 0x00000000, 0x00000000, 0x00000000, 0x00000000 }, { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+		{ 0xffffffffffffffff, { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff }, { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+		{ 0x299f31d0a4093822, { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 }, { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } },
+	};
+	bool passed = true;
+	for (const auto& knownAnswer : knownAnswers) {
+		passed = passed && Philox(knownAnswer.key)(knownAnswer.counter) == knownAnswer.result;
+	}
+	return passed;
+}
+
+/// Generates maps with consecutive seeds with Map::Generate and with the
+/// MapGenerator, and prints the time per map and how many are solvable.
+void BenchmarkGenerator(const TrainerOptions& options) {
+	Map map(std::max(2, options.mapWidth), std::max(2, options.mapHeight));
+	int numSolvable = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < options.numMaps; ++i) {
+		map.SetSeed(options.seed + i);
+		map.Generate(options.numWalls, options.numMines);
+		map(map.GetWidth() - 1, map.GetHeight() - 1).type = Map::Field::FINISH;
+		map(0, 0).type = Map::Field::FREE;
+		numSolvable += MapGenerator::IsSolvable(map);
+	}
+	double legacySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	cout << std::fixed << std::setprecision(3);
+	cout << "Map::Generate:     " << 1000 * legacySeconds / options.numMaps << " ms/map, "
+		<< numSolvable << "/" << options.numMaps << " solvable" << endl;
+
+	const char* names[] = { "scatter", "maze", "clustered", "corridor", "uniform" };
+	const MapGenerator::eLayout layouts[] = { MapGenerator::SCATTER, MapGenerator::MAZE, MapGenerator::CLUSTERED, MapGenerator::CORRIDOR, MapGenerator::UNIFORM };
+	MapGenerator generator;
+	generator.SetSolvability(options.solvability);
+	generator.SetThreads(options.numThreads);
+	cout << "   layout   ms/map   solvable   attempts   cleared/map" << endl;
+	for (int l = 0; l < 5; ++l) {
+		generator.SetLayout(layouts[l]);
+		numSolvable = 0;
+		long long numAttempts = 0, numCleared = 0;
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < options.numMaps; ++i) {
+			generator.SetSeed(options.seed + i);
+			numSolvable += generator.Generate(map, options.numWalls, options.numMines);
+			numAttempts += generator.GetStats().numAttempts;
+			numCleared += generator.GetStats().numCleared;
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		cout << std::setw(9) << names[l]
+			<< std::setprecision(3) << std::setw(9) << 1000 * seconds / options.numMaps
+			<< std::setw(7) << numSolvable << "/" << std::left << std::setw(4) << options.numMaps << std::right
+			<< std::setw(9) << numAttempts
+			<< std::setprecision(2) << std::setw(14) << (double)numCleared / options.numMaps << endl;
+	}
+
+	// the uniform layout must not depend on the number of threads
+	Map reference(map.GetWidth(), map.GetHeight());
+	generator.SetLayout(MapGenerator::UNIFORM);
+	generator.SetSolvability(MapGenerator::ANY);
+	generator.SetSeed(options.seed);
+	generator.SetThreads(1);
+	start = std::chrono::steady_clock::now();
+	generator.Generate(reference, options.numWalls, options.numMines);
+	double serialSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	generator.SetSeed(options.seed);
+	generator.SetThreads(options.numThreads);
+	start = std::chrono::steady_clock::now();
+	generator.Generate(map, options.numWalls, options.numMines);
+	double parallelSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	bool identical = true;
+	size_t rowBytes = 2 * map.GetRowWords() * sizeof(uint64_t);
+	for (int y = 0; y < map.GetHeight(); ++y) {
+		identical = identical && std::memcmp(map.GetRowData(y), reference.GetRowData(y), rowBytes) == 0;
+	}
+	cout << "uniform, no repair: " << std::setprecision(3) << 1000 * serialSeconds << " ms on 1 thread, "
+		<< 1000 * parallelSeconds << " ms on " << options.numThreads << " threads, "
+		<< (identical ? "identical" : "DIFFERENT") << endl;
+	cout << "philox known answers: " << (CheckPhilox() ? "passed" : "FAILED") << endl;
+}
+
+/// Computes the optimal Q table by value iteration, and prints the speed of
+/// the sweeps.
+void SolveOptimal(Map& map, const TrainerOptions& options) {
+	Solver solver;
+	Solver::Stats stats = solver.Solve(map, options.tolerance, options.numThreads);
+	double numCells = (double)map.GetWidth() * map.GetHeight();
+
+	cout << std::fixed << std::setprecision(3);
+	cout << "sweeps:            " << stats.numSweeps << (stats.converged ? "" : " (not converged)") << endl;
+	cout << "residual:          " << std::scientific << stats.residual << std::fixed << endl;
+	cout << "time [s]:          " << stats.seconds << endl;
+	cout << "sweeps/sec:        " << stats.numSweeps / stats.seconds << endl;
+	cout << "fields/sec:        " << stats.numSweeps * numCells / stats.seconds << endl;
+	cout << "optimal value:     " << solver.GetQMax(0, 0) << endl;
+}
+
+/// Prints throughput and reward statistics of a teaching session.
+void PrintReport(const TrainerResult& result) {
+	const auto& history = result.rewardHistory;
+	size_t numEpisodes = history.size();
+	size_t tail = std::max<size_t>(1, numEpisodes / 10);
+
+	double sum = 0, tailSum = 0;
+	for (size_t i = 0; i < numEpisodes; ++i) {
+		sum += history[i];
+		if (i >= numEpisodes - tail) {
+			tailSum += history[i];
+		}
+	}
+	auto minmax = std::minmax_element(history.begin(), history.end());
+
+	cout << std::fixed << std::setprecision(3);
+	cout << "episodes:          " << numEpisodes << endl;
+	cout << "steps:             " << result.numSteps << endl;
+	cout << "time [s]:          " << result.seconds << endl;
+	cout << "episodes/sec:      " << numEpisodes / result.seconds << endl;
+	cout << "steps/sec:         " << result.numSteps / result.seconds << endl;
+	cout << "mean reward:       " << sum / numEpisodes << endl;
+	cout << "mean reward (last " << tail << "): " << tailSum / tail << endl;
+	cout << "min reward:        " << *minmax.first << endl;
+	cout << "max reward:        " << *minmax.second << endl;
+	cout << "final reward:      " << history.back() << endl;
+	if (result.tableBytes > 0) {
+		cout << "table memory [MB]: " << result.tableBytes / 1048576.0 << endl;
+	}
+}
+
+
+int main(int argc, char** argv) {
+	TrainerOptions options;
+	if (!ParseArguments(argc, argv, options)) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+	// everything not seeded explicitly is seeded from the same sequence
+	SetDefaultSeed(options.seed);
+
+	Map map(2, 2);
+	MapInfo info;
+	if (!CreateMap(map, options, info)) {
+		return 1;
+	}
+
+	cout << "map " << map.GetWidth() << "x" << map.GetHeight()
+		<< ", walls = " << info.numWalls
+		<< ", mines = " << info.numMines
+		<< ", iterations = " << options.numIterations
+		<< ", seed = " << options.seed
+		<< ", mode = " << options.mode << endl;
+
+	if (options.mode == "solve") {
+		SolveOptimal(map, options);
+		return 0;
+	}
+	if (options.mode == "library") {
+		return BuildMapLibrary(options) ? 0 : 1;
+	}
+	if (options.mode == "generate") {
+		BenchmarkGenerator(options);
+		return 0;
+	}
+
+	TrainerResult result;
+	if (options.mode == "serial") {
+		result = TeachAgent(map, options);
+	}
+	else if (options.mode == "batch") {
+		result = RolloutBatch(map, options);
+	}
+	else if (options.mode == "hogwild") {
+		result = TeachHogwildScaling(map, options);
+	}
+	else if (options.mode == "average") {
+		result = TeachModelAveraging(map, options);
+	}
+	else if (options.mode == "quantized") {
+		result = TeachQuantizedComparison(map, options);
+	}
+	else {
+		cerr << "unknown mode " << options.mode << endl;
+		PrintUsage(argv[0]);
+		return 1;
+	}
+	PrintReport(result);
+
+	return 0;
+}